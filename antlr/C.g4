@@ -871,6 +871,13 @@ PragmaDirective
         -> channel(3)
     ;
 
+// Other preprocessor lines (#include, #define ...), with their continuation
+// lines. These are kept verbatim so that whole files can be transformed.
+Directive
+    :   '#' ( ~[\\\r\n] | '\\' '\r'? '\n' | '\\' )*
+        -> channel(3)
+    ;
+
 Whitespace
     :   [ \t]+
         -> channel(3)
@@ -10,22 +10,43 @@ public class DeclarationInserter extends CBaseListener {
 	TokenStreamRewriter rewriter;
 	Debug debug;
 	LinkedList<VariableDecl> localVariables;
+	LinkedList<VariableDecl> scalarVariables;	// Not live across a yield
 	int numEntries = 0;
+	boolean refillSlots;
+	boolean ctxStruct;
+	boolean handopt;
+	String templateDir;
+	String count = null;	// Number of lookups, from foreach(batch_index, count)
 	
 	public DeclarationInserter(CParser parser, 
-			TokenStreamRewriter rewriter, LinkedList<VariableDecl> localVariables) {
+			TokenStreamRewriter rewriter, LinkedList<VariableDecl> localVariables,
+			LinkedList<VariableDecl> scalarVariables, boolean refillSlots,
+			boolean ctxStruct, boolean handopt, String templateDir) {
 		this.parser = parser;
 		tokens = parser.getTokenStream();
 		this.rewriter = rewriter;
 		this.debug = new Debug();
 		this.localVariables = localVariables;
+		this.scalarVariables = scalarVariables;
 		this.numEntries = 0;
+		this.refillSlots = refillSlots;
+		this.ctxStruct = ctxStruct;
+		this.handopt = handopt;
+		this.templateDir = templateDir;
+	}
+	
+	@Override
+	public void enterIterationStatement(CParser.IterationStatementContext ctx) {
+		if(ctx.start.getText().contentEquals("foreach")) {
+			count = ctx.Identifier(1).getText();
+		}
 	}
 	
 	// As TokenStreamRewriter only works inside Listeners, we put the code
 	// for inserting lv declarations here. For this to work, either there should be only
 	// one function definition in the input code, or the cleanup should be
-	// idempotent.
+	// idempotent. The declarations are inserted on exit, once the foreach
+	// has been seen.
 	@Override
 	public void enterFunctionDefinition(CParser.FunctionDefinitionContext ctx) {
 		if(numEntries != 0) {
@@ -33,31 +54,67 @@ public class DeclarationInserter extends CBaseListener {
 			System.exit(-1);
 		}
 		numEntries ++;
+	}
+	
+	@Override
+	public void exitFunctionDefinition(CParser.FunctionDefinitionContext ctx) {
+		if(count == null) {
+			System.err.println("ERROR: DeclarationInserter did not find foreach. Aborting.");
+			System.exit(-1);
+		}
 		
-		// Declare all local variables
+		// Declare all local variables: one per lookup if live across a yield
 		String lvDeclarations = "";
-		for(VariableDecl vdecl : localVariables) {
-			lvDeclarations = lvDeclarations + "\t" + vdecl.arrayDecl() + "\n";
+		if(ctxStruct) {
+			if(!localVariables.isEmpty()) {
+				lvDeclarations = lvDeclarations + "\tstruct fpp_ctx {\n";
+				for(VariableDecl vdecl : localVariables) {
+					lvDeclarations = lvDeclarations + "\t\t" + vdecl.scalarDecl() + "\n";
+				}
+				lvDeclarations = lvDeclarations + "\t} __attribute__((aligned(64)));\n";
+				lvDeclarations = lvDeclarations + "\tstruct fpp_ctx ctx[BATCH_SIZE];\n";
+			}
+		} else {
+			for(VariableDecl vdecl : localVariables) {
+				lvDeclarations = lvDeclarations + "\t" + vdecl.arrayDecl() + "\n";
+			}
+		}
+		for(VariableDecl vdecl : scalarVariables) {
+			lvDeclarations = lvDeclarations + "\t" + vdecl.scalarDecl() + "\n";
 		}
 		
+		// The refill scheduler has its own state maintainance code, and
+		// stage-synchronous code has almost none
+		String suffix = refillSlots ? "Refill" : "";
+		if(handopt) {
+			suffix = "Handopt";
+		}
+
 		// State maintainance code at the beginning 
 		String initCode = "";
 		try {
-			initCode = debug.getCode("/Users/akalia/Documents/workspace/fastpp/src/startCode");
+			initCode = debug.getCode(templateDir + "startCode" + suffix);
 		} catch (FileNotFoundException e) {
 			System.err.println("ERROR: startCode file not found");
 			System.exit(-1);
 		}
 		
-		// State maintainance code at the end
+		// State maintainance code at the end. Stage-synchronous code has none:
+		// the last stage loop ends the batch.
 		String endCode = "";
-		try {
-			endCode = debug.getCode("/Users/akalia/Documents/workspace/fastpp/src/endCode");
-		} catch (FileNotFoundException e) {
-			System.err.println("ERROR: endCode file not found");
-			System.exit(-1);
+		if(!handopt) {
+			try {
+				endCode = debug.getCode(templateDir + "endCode" + suffix);
+			} catch (FileNotFoundException e) {
+				System.err.println("ERROR: endCode file not found");
+				System.exit(-1);
+			}
 		}
 		
+		// The templates are written for foreach(batch_index, nb_pkts)
+		initCode = initCode.replaceAll("\\bnb_pkts\\b", count);
+		endCode = endCode.replaceAll("\\bnb_pkts\\b", count);
+		
 		debug.println("Inserting local var declarations from function definition: `" + 
 				debug.btrText(ctx.declarator(), tokens));
 		CParser.CompoundStatementContext csx = ctx.compoundStatement();
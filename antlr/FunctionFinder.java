@@ -0,0 +1,68 @@
+import java.util.LinkedList;
+
+import org.antlr.v4.runtime.TokenStream;
+
+// A function definition in the input file
+class FunctionInfo {
+	String name;
+	String code;
+	boolean hasForeach;
+
+	public FunctionInfo(String name, String code) {
+		this.name = name;
+		this.code = code;
+		this.hasForeach = false;
+	}
+}
+
+// Lists the function definitions of a translation unit, and finds the ones
+// with a foreach loop. Each of these is transformed on its own.
+public class FunctionFinder extends CBaseListener {
+	CParser parser;
+	TokenStream tokens;
+	Debug debug;
+	LinkedList<FunctionInfo> functions;
+	FunctionInfo current = null;
+
+	public FunctionFinder(CParser parser) {
+		this.parser = parser;
+		tokens = parser.getTokenStream();
+		this.debug = new Debug();
+		functions = new LinkedList<FunctionInfo>();
+	}
+
+	@Override
+	public void enterFunctionDefinition(CParser.FunctionDefinitionContext ctx) {
+		String name = debug.functionName(ctx);
+		if(name == null) {
+			System.err.println("WARNING: Skipping function definition at line " +
+					ctx.start.getLine() + ": no name in its declarator");
+			return;
+		}
+
+		current = new FunctionInfo(name, debug.btrText(ctx, tokens));
+		functions.addLast(current);
+	}
+
+	@Override
+	public void exitFunctionDefinition(CParser.FunctionDefinitionContext ctx) {
+		if(current == null) {
+			return;
+		}
+		debug.println("FunctionFinder found function " + current.name +
+				(current.hasForeach ? " with foreach" : ""));
+		current = null;
+	}
+
+	@Override
+	public void enterIterationStatement(CParser.IterationStatementContext ctx) {
+		if(current != null && ctx.getText().startsWith("foreach")) {
+			if(current.hasForeach) {
+				System.err.println("ERROR: Function " + current.name +
+						" has more than one foreach. Aborting.");
+				System.exit(-1);
+			}
+			current.hasForeach = true;
+		}
+	}
+}
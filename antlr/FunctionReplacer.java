@@ -0,0 +1,42 @@
+import java.util.HashMap;
+
+import org.antlr.v4.runtime.TokenStream;
+import org.antlr.v4.runtime.TokenStreamRewriter;
+
+// Replaces the transformed functions of a translation unit with their goto
+// version. The other functions are left untouched. fpp.h is included before
+// the first transformed function, unless the file already includes it.
+public class FunctionReplacer extends CBaseListener {
+	CParser parser;
+	TokenStream tokens;
+	TokenStreamRewriter rewriter;
+	Debug debug;
+	HashMap<String, String> gotoCode;		// Function name -> goto version
+	boolean includeFpp;
+
+	public FunctionReplacer(CParser parser, TokenStreamRewriter rewriter,
+			HashMap<String, String> gotoCode, boolean includeFpp) {
+		this.parser = parser;
+		tokens = parser.getTokenStream();
+		this.rewriter = rewriter;
+		this.debug = new Debug();
+		this.gotoCode = gotoCode;
+		this.includeFpp = includeFpp;
+	}
+
+	@Override
+	public void enterFunctionDefinition(CParser.FunctionDefinitionContext ctx) {
+		String name = debug.functionName(ctx);
+		if(name == null || !gotoCode.containsKey(name)) {
+			return;
+		}
+
+		debug.println("FunctionReplacer replacing function " + name);
+		String code = gotoCode.get(name);
+		if(includeFpp) {
+			code = "#include \"fpp.h\"\n" + code;
+			includeFpp = false;
+		}
+		rewriter.replace(ctx.start, ctx.stop, code);
+	}
+}
@@ -0,0 +1,134 @@
+import java.util.HashMap;
+import java.util.LinkedList;
+
+import org.antlr.v4.runtime.TokenStream;
+import org.antlr.v4.runtime.TokenStreamRewriter;
+
+// Lowers the jumps in the foreach body that end the work on the current
+// lookup. Once the foreach loop is deleted, a `continue` that belongs to it
+// would continue an enclosing loop (or not compile), and a `return` would
+// end the whole batch. Both become `goto fpp_end;`, where the slot is marked
+// done. Jumps that belong to a loop or switch inside the body are unchanged.
+//
+// The input can use goto between labels inside the foreach body. Jumps into
+// or out of the body, a `break` out of the foreach, and `return` with a value
+// cannot be expressed per lookup and abort the transformation.
+public class JumpLowerer extends CBaseListener {
+	CParser parser;
+	TokenStream tokens;
+	TokenStreamRewriter rewriter;
+	Debug debug;
+
+	boolean inForeach = false;
+	int loopDepth = 0;		// Loops in the foreach body around the current statement
+	int breakDepth = 0;		// Loops and switches, which take a break
+
+	HashMap<String, Boolean> labels;	// Label -> is it in the foreach body?
+	LinkedList<String> gotos;			// Targets of gotos in the foreach body
+	LinkedList<String> outerGotos;		// Targets of gotos outside
+
+	public JumpLowerer(CParser parser, TokenStreamRewriter rewriter) {
+		this.parser = parser;
+		tokens = parser.getTokenStream();
+		this.rewriter = rewriter;
+		this.debug = new Debug();
+
+		labels = new HashMap<String, Boolean>();
+		gotos = new LinkedList<String>();
+		outerGotos = new LinkedList<String>();
+	}
+
+	private void abort(String message) {
+		System.err.println("ERROR: " + message + ". Aborting.");
+		System.exit(-1);
+	}
+
+	@Override
+	public void enterIterationStatement(CParser.IterationStatementContext ctx) {
+		if(ctx.start.getText().contentEquals("foreach")) {
+			inForeach = true;
+		} else if(inForeach) {
+			loopDepth ++;
+			breakDepth ++;
+		}
+	}
+
+	@Override
+	public void exitIterationStatement(CParser.IterationStatementContext ctx) {
+		if(ctx.start.getText().contentEquals("foreach")) {
+			inForeach = false;
+		} else if(inForeach) {
+			loopDepth --;
+			breakDepth --;
+		}
+	}
+
+	@Override
+	public void enterSelectionStatement(CParser.SelectionStatementContext ctx) {
+		if(inForeach && ctx.start.getText().contentEquals("switch")) {
+			breakDepth ++;
+		}
+	}
+
+	@Override
+	public void exitSelectionStatement(CParser.SelectionStatementContext ctx) {
+		if(inForeach && ctx.start.getText().contentEquals("switch")) {
+			breakDepth --;
+		}
+	}
+
+	@Override
+	public void enterLabeledStatement(CParser.LabeledStatementContext ctx) {
+		if(ctx.Identifier() != null) {
+			labels.put(ctx.Identifier().getText(), inForeach);
+		}
+	}
+
+	@Override
+	public void enterJumpStatement(CParser.JumpStatementContext ctx) {
+		String jump = ctx.start.getText();
+
+		if(jump.contentEquals("goto")) {
+			if(ctx.Identifier() == null) {
+				abort("Computed goto in input code");
+			}
+			if(inForeach) {
+				gotos.addLast(ctx.Identifier().getText());
+			} else {
+				outerGotos.addLast(ctx.Identifier().getText());
+			}
+			return;
+		}
+
+		if(!inForeach) {
+			return;
+		}
+
+		if(jump.contentEquals("continue") && loopDepth == 0) {
+			debug.println("JumpLowerer lowering per-lookup continue");
+			rewriter.replace(ctx.start, ctx.stop, "goto fpp_end;");
+		} else if(jump.contentEquals("return")) {
+			if(ctx.expression() != null) {
+				abort("return with a value in foreach");
+			}
+			debug.println("JumpLowerer lowering per-lookup return");
+			rewriter.replace(ctx.start, ctx.stop, "goto fpp_end;");
+		} else if(jump.contentEquals("break") && breakDepth == 0) {
+			abort("break out of foreach");
+		}
+	}
+
+	@Override
+	public void exitCompilationUnit(CParser.CompilationUnitContext ctx) {
+		for(String label : gotos) {
+			if(!labels.containsKey(label) || !labels.get(label)) {
+				abort("goto " + label + " jumps out of foreach");
+			}
+		}
+		for(String label : outerGotos) {
+			if(labels.containsKey(label) && labels.get(label)) {
+				abort("goto " + label + " jumps into foreach");
+			}
+		}
+	}
+}
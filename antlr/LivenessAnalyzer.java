@@ -0,0 +1,229 @@
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.LinkedList;
+import java.util.regex.Matcher;
+import java.util.regex.Pattern;
+
+import org.antlr.v4.runtime.TokenStream;
+import org.antlr.v4.runtime.misc.Interval;
+
+// Finds the local variables that are live across a yield (an FPP_EXPENSIVE
+// statement, which becomes an FPP_PSS switch point). Only these need a slot
+// per lookup: the others never hold a value while another lookup runs, so
+// they can stay scalars that the compiler keeps in registers.
+//
+// The foreach body is split into regions at the yields, in token order. In
+// code without loops, every path between two uses of a variable goes forward
+// in token order, so a variable whose uses all lie in one region is never
+// live across a yield. The analysis is conservative otherwise: a variable is
+// live if it is used in more than one region, outside the foreach body,
+// inside a loop (or a backward goto) that contains a yield, or if its address
+// is taken. An array is always live: it decays to a pointer wherever it is
+// used.
+public class LivenessAnalyzer extends CBaseListener {
+	CParser parser;
+	TokenStream tokens;
+	Debug debug;
+	LinkedList<VariableDecl> localVariables;
+
+	Interval foreachBody = null;	// Token interval of the foreach's { }
+	LinkedList<Integer> yields;		// Token index of each FPP_EXPENSIVE's ')'
+	LinkedList<Interval> loops;		// Loops nested in the foreach body
+	HashMap<String, LinkedList<Integer>> uses;	// Token indices of each local's uses
+	HashSet<String> addressTaken;
+	HashMap<String, Integer> labels;	// Token index of each label
+	LinkedList<Integer> gotos;			// Token index of each goto
+	LinkedList<String> gotoTargets;
+	LinkedList<VariableDecl> scalarVariables;	// Filled by liveVariables()
+
+	public LivenessAnalyzer(CParser parser, LinkedList<VariableDecl> localVariables) {
+		this.parser = parser;
+		tokens = parser.getTokenStream();
+		this.debug = new Debug();
+		this.localVariables = localVariables;
+
+		yields = new LinkedList<Integer>();
+		loops = new LinkedList<Interval>();
+		uses = new HashMap<String, LinkedList<Integer>>();
+		addressTaken = new HashSet<String>();
+		labels = new HashMap<String, Integer>();
+		gotos = new LinkedList<Integer>();
+		gotoTargets = new LinkedList<String>();
+		scalarVariables = new LinkedList<VariableDecl>();
+	}
+
+	@Override
+	public void enterIterationStatement(CParser.IterationStatementContext ctx) {
+		if(ctx.getText().startsWith("foreach")) {
+			foreachBody = ctx.compoundStatement().getSourceInterval();
+		} else {
+			loops.addLast(ctx.getSourceInterval());
+		}
+	}
+
+	// Uses after FPP_EXPENSIVE's ')' are after the switch. The argument is
+	// evaluated before it.
+	@Override
+	public void enterPostfixExpression(CParser.PostfixExpressionContext ctx) {
+		if(ctx.getText().startsWith("FPP_EXPENSIVE") && ctx.getChildCount() == 4) {
+			yields.addLast(ctx.stop.getTokenIndex());
+		}
+	}
+
+	// A goto back to a label is a loop. Gotos forward keep uses in token
+	// order, like if-else. (JumpLowerer allows no gotos into or out of the
+	// foreach body, and per-lookup gotos to fpp_end end the lookup.)
+	@Override
+	public void enterLabeledStatement(CParser.LabeledStatementContext ctx) {
+		if(ctx.Identifier() != null) {
+			labels.put(ctx.Identifier().getText(), ctx.start.getTokenIndex());
+		}
+	}
+
+	@Override
+	public void enterJumpStatement(CParser.JumpStatementContext ctx) {
+		if(ctx.start.getText().contentEquals("goto") && ctx.Identifier() != null) {
+			gotos.addLast(ctx.start.getTokenIndex());
+			gotoTargets.addLast(ctx.Identifier().getText());
+		}
+	}
+
+	// An initialized declaration becomes an assignment in the generated code,
+	// so it counts as a use
+	@Override
+	public void enterInitDeclarator(CParser.InitDeclaratorContext ctx) {
+		if(ctx.initializer() != null) {
+			addUse(ctx.declarator().getText(), ctx.start.getTokenIndex());
+		}
+	}
+
+	@Override
+	public void enterPrimaryExpression(CParser.PrimaryExpressionContext ctx) {
+		addUse(debug.btrText(ctx, tokens), ctx.start.getTokenIndex());
+	}
+
+	// Once its address is taken, a variable can be accessed through a
+	// pointer anywhere after that. This includes the address of a part of it,
+	// like &s.f or &a[i]: the operand's root is the variable. &p->f is the
+	// address of what p points to, not of p.
+	@Override
+	public void enterUnaryExpression(CParser.UnaryExpressionContext ctx) {
+		if(ctx.unaryOperator() != null && ctx.unaryOperator().getText().contentEquals("&")) {
+			String operand = ctx.castExpression().getText().replaceAll("[()]", "");
+
+			// Drop the subscripts, which can contain -> of their own
+			String path = operand, prev;
+			do {
+				prev = path;
+				path = path.replaceAll("\\[[^\\[\\]]*\\]", "");
+			} while(!path.contentEquals(prev));
+			if(path.contains("->")) {
+				return;
+			}
+
+			Matcher root = Pattern.compile("^[A-Za-z_][A-Za-z0-9_]*").matcher(path);
+			if(root.find() && isLocal(root.group())) {
+				addressTaken.add(root.group());
+			}
+		}
+	}
+
+	private boolean isLocal(String name) {
+		return localVariables.contains(new VariableDecl("", name, ""));
+	}
+
+	private void addUse(String name, int tokenIndex) {
+		name = name.replaceAll("[*]+", "");
+		if(!isLocal(name)) {
+			return;
+		}
+
+		if(!uses.containsKey(name)) {
+			uses.put(name, new LinkedList<Integer>());
+		}
+		uses.get(name).addLast(tokenIndex);
+	}
+
+	// The number of yields before a token
+	private int region(int tokenIndex) {
+		int ret = 0;
+		for(int yield : yields) {
+			if(yield < tokenIndex) {
+				ret ++;
+			}
+		}
+		return ret;
+	}
+
+	private boolean inLoopWithYield(int tokenIndex) {
+		for(Interval loop : loops) {
+			if(!loop.properlyContains(Interval.of(tokenIndex, tokenIndex))) {
+				continue;
+			}
+			for(int yield : yields) {
+				if(loop.properlyContains(Interval.of(yield, yield))) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	private boolean isLive(String name) {
+		if(addressTaken.contains(name)) {
+			debug.println("\tLivenessAnalyzer: address of " + name + " is taken");
+			return true;
+		}
+
+		LinkedList<Integer> varUses = uses.get(name);
+		if(varUses == null) {
+			return false;
+		}
+
+		int firstRegion = region(varUses.getFirst());
+		for(int use : varUses) {
+			if(!foreachBody.properlyContains(Interval.of(use, use))) {
+				debug.println("\tLivenessAnalyzer: " + name + " is used outside foreach");
+				return true;
+			}
+			if(inLoopWithYield(use)) {
+				debug.println("\tLivenessAnalyzer: " + name + " is used in a loop with a yield");
+				return true;
+			}
+			if(region(use) != firstRegion) {
+				debug.println("\tLivenessAnalyzer: " + name + " is used across a yield");
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Call after walking the tree. Returns the local variables that need
+	// per-lookup storage, in declaration order. The rest go to scalarVariables.
+	public LinkedList<VariableDecl> liveVariables() {
+		if(foreachBody == null) {
+			System.err.println("ERROR: LivenessAnalyzer did not find foreach. Aborting.");
+			System.exit(-1);
+		}
+
+		for(int i = 0; i < gotos.size(); i ++) {
+			Integer label = labels.get(gotoTargets.get(i));
+			if(label != null && label < gotos.get(i)) {
+				loops.addLast(Interval.of(label, gotos.get(i)));
+			}
+		}
+
+		LinkedList<VariableDecl> ret = new LinkedList<VariableDecl>();
+		for(VariableDecl vdecl : localVariables) {
+			if(vdecl.name.contains("[")) {
+				debug.println("\tLivenessAnalyzer: " + vdecl.name + " is an array");
+				ret.addLast(vdecl);
+			} else if(isLive(vdecl.name.replaceAll("[*]+", ""))) {
+				ret.addLast(vdecl);
+			} else {
+				scalarVariables.addLast(vdecl);
+			}
+		}
+		return ret;
+	}
+}
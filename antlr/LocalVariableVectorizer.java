@@ -10,15 +10,20 @@ public class LocalVariableVectorizer extends CBaseListener {
 	Debug debug;
 	LinkedList<VariableDecl> localVariables;
 	int numPrinted = 0;
+	boolean refillSlots;
+	boolean ctxStruct;
 	
 	public LocalVariableVectorizer(CParser parser, 
-			TokenStreamRewriter rewriter, LinkedList<VariableDecl> localVariables) {
+			TokenStreamRewriter rewriter, LinkedList<VariableDecl> localVariables,
+			boolean refillSlots, boolean ctxStruct) {
 		this.parser = parser;
 		tokens = parser.getTokenStream();
 		this.rewriter = rewriter;
 		this.debug = new Debug();
 		this.localVariables = localVariables;
 		this.numPrinted = 0;
+		this.refillSlots = refillSlots;
+		this.ctxStruct = ctxStruct;
 	}
 	
 	// primaryExpression is a variable, a constant, or an expression in braces.
@@ -27,9 +32,10 @@ public class LocalVariableVectorizer extends CBaseListener {
 	public void enterPrimaryExpression(CParser.PrimaryExpressionContext ctx) {
 		String primaryExpression = debug.btrText(ctx, tokens);
 		
-		// Replace all usages of batch_index by I
+		// Replace all usages of batch_index by I, or by the input of slot I
+		// when slots are refilled
 		if(primaryExpression.contentEquals("batch_index")) {
-			rewriter.replace(ctx.start, "I");
+			rewriter.replace(ctx.start, refillSlots ? "fpp_in[I]" : "I");
 			return;
 		}
 		
@@ -44,7 +50,11 @@ public class LocalVariableVectorizer extends CBaseListener {
 			}
 			
 			numPrinted ++;
-			rewriter.replace(ctx.start, primaryExpression + "[I]");
+			if(ctxStruct) {
+				rewriter.replace(ctx.start, "ctx[I]." + primaryExpression);
+			} else {
+				rewriter.replace(ctx.start, primaryExpression + "[I]");
+			}
 		}
 	}
 	
@@ -1,6 +1,7 @@
 import java.io.File;
 import java.io.FileNotFoundException;
 import java.io.PrintWriter;
+import java.util.HashMap;
 import java.util.LinkedList;
 import java.util.Scanner;
 
@@ -12,45 +13,200 @@ import org.antlr.v4.runtime.TokenStreamRewriter;
 import org.antlr.v4.runtime.tree.ParseTreeWalker;
 
 public class Main {
-	static String gotoFilePath = "/Users/akalia/Documents/workspace/fastpp/test/dpdk-ipv6/nogoto.c";
 	static Debug util;
+
+	// Directory with the startCode and endCode templates. By default, the
+	// directory that Main is run from (the antlr directory).
+	static String templateDir = "./";
+
+	// Scheduler for the generated code. With refill, the foreach loop runs
+	// over all nb_pkts inputs and a slot takes a new input as soon as its
+	// lookup ends, instead of idling until the whole batch is done.
+	static boolean refillSlots = false;
+
+	// Only vectorize the local variables that are live across a yield. The
+	// others stay scalars, which the compiler can keep in registers.
+	static boolean vectorizeLiveOnly = true;
+
+	// Layout of the vectorized locals. By default each local is its own
+	// BATCH_SIZE array (x[I]). With ctxStruct, they are fields of a cache
+	// line aligned struct fpp_ctx, one per lookup (ctx[I].x), so the state of
+	// a lookup is on as few cache lines as possible.
+	static boolean ctxStruct = false;
+
+	// Generate stage-synchronous code (like the benchmarks' handopt.c)
+	// instead of goto code: see StageSplitter
+	static boolean handopt = false;
+
+	private static void usage() {
+		System.err.println("Usage: java Main [options] input.c [output.c]");
+		System.err.println("Transforms every function with a foreach loop in input.c, and");
+		System.err.println("writes the file to output.c (default: input.c.proc).");
+		System.err.println("\t-f name\t\tOnly transform function name (can be repeated)");
+		System.err.println("\t-refill\t\tUse the slot-refill scheduler");
+		System.err.println("\t-ctx\t\tPack vectorized locals into per-lookup structs");
+		System.err.println("\t-all-locals\tVectorize all locals, not only the live ones");
+		System.err.println("\t-handopt\tGenerate stage-synchronous code instead of goto code");
+		System.err.println("\t-templates dir\tDirectory with startCode and endCode");
+		System.exit(-1);
+	}
 	
 	public static void main(String args[]) throws FileNotFoundException {
 		util = new Debug();
 		
-		String code = getCode(gotoFilePath);
+		LinkedList<String> only = new LinkedList<String>();
+		String inputPath = null, outputPath = null;
+		
+		for(int i = 0; i < args.length; i ++) {
+			if(args[i].contentEquals("-f") && i + 1 < args.length) {
+				only.addLast(args[++ i]);
+			} else if(args[i].contentEquals("-templates") && i + 1 < args.length) {
+				templateDir = args[++ i] + "/";
+			} else if(args[i].contentEquals("-refill")) {
+				refillSlots = true;
+			} else if(args[i].contentEquals("-ctx")) {
+				ctxStruct = true;
+			} else if(args[i].contentEquals("-all-locals")) {
+				vectorizeLiveOnly = false;
+			} else if(args[i].contentEquals("-handopt")) {
+				handopt = true;
+			} else if(args[i].startsWith("-")) {
+				usage();
+			} else if(inputPath == null) {
+				inputPath = args[i];
+			} else if(outputPath == null) {
+				outputPath = args[i];
+			} else {
+				usage();
+			}
+		}
+		
+		if(inputPath == null || (handopt && refillSlots)) {
+			usage();
+		}
+		if(outputPath == null) {
+			outputPath = inputPath + ".proc";
+		}
+		
+		String code = transformFile(getCode(inputPath), only);
+		
+		System.out.flush();
+		System.err.println("\nFinal code:");
+		System.err.flush();
+		System.out.println(code);
+		
+		PrintWriter out = new PrintWriter(new File(outputPath));
+		out.println(code);
+		out.close();
+	}
+	
+	// Transform the functions of a translation unit that have a foreach
+	// loop, or only the ones in the list if it is not empty. Each function
+	// goes through all the passes on its own.
+	private static String transformFile(String code, LinkedList<String> only) {
+		System.out.println("Finding functions to transform");
+
+		CharStream charStream = new ANTLRInputStream(code);		
+		CLexer lexer = new CLexer(charStream);
+		CommonTokenStream tokens = new CommonTokenStream(lexer);
+		TokenStreamRewriter rewriter = new TokenStreamRewriter(tokens);
+		CParser parser = new CParser(tokens);
+		
+		// Parse and get the root of the parse tree
+		ParserRuleContext tree = parser.compilationUnit();
 
+		ParseTreeWalker walker = new ParseTreeWalker();
+		FunctionFinder finder = new FunctionFinder(parser);
+		walker.walk(finder, tree);
+		
+		HashMap<String, String> gotoCode = new HashMap<String, String>();
+		for(FunctionInfo func : finder.functions) {
+			if(!only.isEmpty() && !only.contains(func.name)) {
+				continue;
+			}
+			if(!func.hasForeach) {
+				if(only.contains(func.name)) {
+					System.err.println("ERROR: Function " + func.name + " has no foreach. Aborting.");
+					System.exit(-1);
+				}
+				continue;
+			}
+			
+			System.out.println("\n\nTransforming function " + func.name);
+			gotoCode.put(func.name, transformFunction(func.code));
+		}
+		
+		for(String name : only) {
+			if(!gotoCode.containsKey(name)) {
+				System.err.println("ERROR: Function " + name + " not found. Aborting.");
+				System.exit(-1);
+			}
+		}
+		if(gotoCode.isEmpty()) {
+			System.err.println("ERROR: No function with a foreach loop. Aborting.");
+			System.exit(-1);
+		}
+		
+		// fpp.h is included once per file, before the first transformed function
+		boolean includeFpp = !code.matches("(?s).*#\\s*include\\s*\"fpp.h\".*");
+		FunctionReplacer replacer = new FunctionReplacer(parser, rewriter, gotoCode, includeFpp);
+		walker.walk(replacer, tree);
+		
+		return rewriter.getText();
+	}
+	
+	// Transform one function definition
+	private static String transformFunction(String code) {
 		checkLocalVariableReuse(code);
+		if(!handopt) {
+			code = lowerJumps(code);
+		}
 
 		LinkedList<VariableDecl> localVars = extractLocalVariables(code);
+		LinkedList<VariableDecl> scalarVars = new LinkedList<VariableDecl>();
+		if(vectorizeLiveOnly) {
+			localVars = analyzeLiveness(code, localVars, scalarVars);
+		}
+
 		code = trimDeclarations(code);
 		code = cleanup(code);
 		code = vectorizeLocalVariables(code, localVars);
 	
 		// This should be done after vectorizing local variable usage
 		// otherwise, the inserted declarations get vectorized
-		code = insertLocalVariableDeclarations(code, localVars);
-		code = deleteForeach(code, localVars);
-		
-		code = insertPrefetches(code);
+		code = insertLocalVariableDeclarations(code, localVars, scalarVars);
+		if(handopt) {
+			code = splitStages(code);
+		} else {
+			code = deleteForeach(code, localVars);
+			code = insertPrefetches(code);
+		}
 		code = cleanup(code);
+		return code;
+	}
+
+	private static String lowerJumps(String code) {
+		System.out.println("\n\nLowering per-lookup jumps");
+
+		CharStream charStream = new ANTLRInputStream(code);		
+		CLexer lexer = new CLexer(charStream);
+		CommonTokenStream tokens = new CommonTokenStream(lexer);
+		TokenStreamRewriter rewriter = new TokenStreamRewriter(tokens);
+		CParser parser = new CParser(tokens);
 		
-		// This needs to be the last pass. Resultant code cannot
-		// be parsed
-		code = insertIncludeFpp(code);
+		// Parse and get the root of the parse tree
+		ParserRuleContext tree = parser.compilationUnit();
+
+		JumpLowerer jLowerer = new JumpLowerer(parser, rewriter);
 		
-		System.out.flush();
-		System.err.println("\nFinal code:");
-		System.err.flush();
-		System.out.println(code);
+		ParseTreeWalker walker = new ParseTreeWalker();
+		walker.walk(jLowerer, tree);
 		
-		PrintWriter out = new PrintWriter(new File(gotoFilePath + ".proc"));
-		out.println(code);
-		out.close();
+		return rewriter.getText();
 	}
-	
-	private static String insertIncludeFpp(String code) {
-		System.out.println("\n\nInserting macros");
+
+	private static String splitStages(String code) {
+		System.out.println("\n\nSplitting foreach into stages");
 
 		CharStream charStream = new ANTLRInputStream(code);		
 		CLexer lexer = new CLexer(charStream);
@@ -61,12 +217,11 @@ public class Main {
 		// Parse and get the root of the parse tree
 		ParserRuleContext tree = parser.compilationUnit();
 
-		IncludeInserter mInserter = new IncludeInserter(parser, rewriter);
+		StageSplitter sSplitter = new StageSplitter(parser, rewriter);
 		
 		ParseTreeWalker walker = new ParseTreeWalker();
-		walker.walk(mInserter, tree);
+		walker.walk(sSplitter, tree);
 		
-		System.err.println();  // We print the replaced local vars on a single line
 		return rewriter.getText();
 	}
 
@@ -101,7 +256,7 @@ public class Main {
 		// Parse and get the root of the parse tree
 		ParserRuleContext tree = parser.compilationUnit();
 
-		ReuseChecker rChecker = new ReuseChecker(parser);
+		ReuseChecker rChecker = new ReuseChecker(parser, refillSlots, ctxStruct);
 		
 		ParseTreeWalker walker = new ParseTreeWalker();
 		walker.walk(rChecker, tree);
@@ -131,7 +286,7 @@ public class Main {
 	}
 
 	private static String insertLocalVariableDeclarations(String code,
-			LinkedList<VariableDecl> localVars) {
+			LinkedList<VariableDecl> localVars, LinkedList<VariableDecl> scalarVars) {
 		System.out.println("\n\nInserting local variable declarations");
 
 		CharStream charStream = new ANTLRInputStream(code);		
@@ -144,7 +299,7 @@ public class Main {
 		ParserRuleContext tree = parser.compilationUnit();
 
 		DeclarationInserter dInserter = new DeclarationInserter(parser, 
-				rewriter, localVars);
+				rewriter, localVars, scalarVars, refillSlots, ctxStruct, handopt, templateDir);
 		
 		ParseTreeWalker walker = new ParseTreeWalker();
 		walker.walk(dInserter, tree);
@@ -167,7 +322,7 @@ public class Main {
 		ParserRuleContext tree = parser.compilationUnit();
 
 		LocalVariableVectorizer lvVectorizer = new LocalVariableVectorizer(parser, 
-				rewriter, localVars);
+				rewriter, localVars, refillSlots, ctxStruct);
 		
 		ParseTreeWalker walker = new ParseTreeWalker();
 		walker.walk(lvVectorizer, tree);
@@ -240,9 +395,36 @@ public class Main {
 		return extractor.ret;
 	}
 
+	// Returns the local variables that are live across a yield, and adds
+	// the others to scalarVars
+	private static LinkedList<VariableDecl> analyzeLiveness(String code,
+			LinkedList<VariableDecl> localVars, LinkedList<VariableDecl> scalarVars) {
+		System.out.println("\n\nFinding local variables live across a yield");
+		
+		CharStream charStream = new ANTLRInputStream(code);
+		CLexer lexer = new CLexer(charStream);
+		CommonTokenStream tokens = new CommonTokenStream(lexer);
+		CParser parser = new CParser(tokens);
+		
+		// Parse and get the root of the parse tree
+		ParserRuleContext tree = parser.compilationUnit();
+
+		ParseTreeWalker walker = new ParseTreeWalker();
+		LivenessAnalyzer analyzer = new LivenessAnalyzer(parser, localVars);
+		walker.walk(analyzer, tree);
+		
+		LinkedList<VariableDecl> liveVars = analyzer.liveVariables();
+		System.out.println("Local variables that stay scalars:");
+		for(VariableDecl var : analyzer.scalarVariables) {
+			System.out.println(var.type + ", " + var.name + ", " + var.value);
+			scalarVars.addLast(var);
+		}
+		return liveVars;
+	}
+
 	// Get a String representation of the input code
-	private static String getCode(String gotoFilePath) throws FileNotFoundException {
-		Scanner c = new Scanner(new File(gotoFilePath));
+	private static String getCode(String path) throws FileNotFoundException {
+		Scanner c = new Scanner(new File(path));
 		String res = "";
 		while(c.hasNext()) {
 			res += c.nextLine();
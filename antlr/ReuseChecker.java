@@ -9,7 +9,7 @@ public class ReuseChecker extends CBaseListener {
 	Debug debug;
 	List<String> myVars;	// Local vars used by our compiler	
 	
-	public ReuseChecker(CParser parser) {
+	public ReuseChecker(CParser parser, boolean refillSlots, boolean ctxStruct) {
 		this.parser = parser;
 		tokens = parser.getTokenStream();
 		this.debug = new Debug();
@@ -21,6 +21,13 @@ public class ReuseChecker extends CBaseListener {
 		myVars.add("temp_index");
 		myVars.add("FPP_PSS");
 		myVars.add("FPP_SET");
+		if(refillSlots) {		// Declared by startCodeRefill
+			myVars.add("fpp_in");
+			myVars.add("fpp_next");
+		}
+		if(ctxStruct) {
+			myVars.add("ctx");
+		}
 	}
 
 	// primaryExpression is a variable, a constant, or an expression in braces.
@@ -33,4 +40,13 @@ public class ReuseChecker extends CBaseListener {
 			System.exit(-1);
 		}
 	}
+
+	// Our labels are fpp_start, fpp_end and fpp_label_N
+	@Override
+	public void enterLabeledStatement(CParser.LabeledStatementContext ctx) {
+		if(ctx.Identifier() != null && ctx.Identifier().getText().startsWith("fpp_")) {
+			System.err.println("ERROR: forbidden label " + ctx.Identifier().getText() + " appears in code");
+			System.exit(-1);
+		}
+	}
 }
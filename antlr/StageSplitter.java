@@ -0,0 +1,157 @@
+import org.antlr.v4.runtime.TokenStream;
+import org.antlr.v4.runtime.TokenStreamRewriter;
+
+// Generates stage-synchronous ("handopt") code instead of goto code. The
+// foreach body is split into stages at the FPP_EXPENSIVE statements, and
+// each stage becomes a loop over the whole batch that ends by prefetching
+// the next stage's memory for every lookup:
+//
+//	for(I = 0; I < n; I ++) { stage 0; __builtin_prefetch(addr_0[I], 0, 0); }
+//	for(I = 0; I < n; I ++) { stage 1; ... }
+//
+// This only works if every lookup reaches every yield, in order: each
+// FPP_EXPENSIVE must be a statement of the foreach body itself, not inside
+// an if, loop or switch, and the body must not end a lookup early. Code
+// that does not qualify needs the goto transformation.
+public class StageSplitter extends CBaseListener {
+	CParser parser;
+	TokenStream tokens;
+	TokenStreamRewriter rewriter;
+	Debug debug;
+
+	CParser.CompoundStatementContext foreachBody = null;
+	String stageLoop;		// Header of each stage loop
+	int depth = 0;			// Statements around the current one in the foreach body
+	int loopDepth = 0;
+	int breakDepth = 0;		// Loops and switches, which take a break
+	int numStages = 1;
+
+	public StageSplitter(CParser parser, TokenStreamRewriter rewriter) {
+		this.parser = parser;
+		tokens = parser.getTokenStream();
+		this.rewriter = rewriter;
+		this.debug = new Debug();
+	}
+
+	private void abort(String message) {
+		System.err.println("ERROR: " + message + ". Use the goto transformation. Aborting.");
+		System.exit(-1);
+	}
+
+	@Override
+	public void enterIterationStatement(CParser.IterationStatementContext ctx) {
+		if(ctx.start.getText().contentEquals("foreach")) {
+			foreachBody = ctx.compoundStatement();
+			stageLoop = "for(I = 0; I < " + ctx.Identifier(1).getText() + "; I ++) {";
+
+			// Replace "foreach(batch_index, n) {" by the first stage loop
+			rewriter.replace(ctx.start, foreachBody.start, stageLoop);
+		} else if(foreachBody != null) {
+			depth ++;
+			loopDepth ++;
+			breakDepth ++;
+		}
+	}
+
+	@Override
+	public void exitIterationStatement(CParser.IterationStatementContext ctx) {
+		if(ctx.start.getText().contentEquals("foreach")) {
+			debug.println("StageSplitter split foreach into " + numStages + " stages");
+			foreachBody = null;
+		} else if(foreachBody != null) {
+			depth --;
+			loopDepth --;
+			breakDepth --;
+		}
+	}
+
+	@Override
+	public void enterSelectionStatement(CParser.SelectionStatementContext ctx) {
+		if(foreachBody != null) {
+			depth ++;
+			if(ctx.start.getText().contentEquals("switch")) {
+				breakDepth ++;
+			}
+		}
+	}
+
+	@Override
+	public void exitSelectionStatement(CParser.SelectionStatementContext ctx) {
+		if(foreachBody != null) {
+			depth --;
+			if(ctx.start.getText().contentEquals("switch")) {
+				breakDepth --;
+			}
+		}
+	}
+
+	@Override
+	public void enterCompoundStatement(CParser.CompoundStatementContext ctx) {
+		if(foreachBody != null && ctx != foreachBody) {
+			depth ++;
+		}
+	}
+
+	@Override
+	public void exitCompoundStatement(CParser.CompoundStatementContext ctx) {
+		if(foreachBody != null && ctx != foreachBody) {
+			depth --;
+		}
+	}
+
+	// JumpLowerer does not run for handopt, so the jumps that end a lookup
+	// are checked here
+	@Override
+	public void enterJumpStatement(CParser.JumpStatementContext ctx) {
+		if(foreachBody == null) {
+			return;
+		}
+
+		String jump = ctx.start.getText();
+		if(jump.contentEquals("return") || jump.contentEquals("goto") ||
+				(jump.contentEquals("continue") && loopDepth == 0)) {
+			abort("Lookups can end early (" + jump + " in foreach)");
+		}
+		if(jump.contentEquals("break") && breakDepth == 0) {
+			abort("break out of foreach");
+		}
+	}
+
+	@Override
+	public void enterPostfixExpression(CParser.PostfixExpressionContext ctx) {
+		if(!ctx.getText().startsWith("FPP_EXPENSIVE")) {
+			return;
+		}
+
+		int start = ctx.start.getTokenIndex();
+		int stop = ctx.stop.getTokenIndex();
+		if(stop == start) {		// Only "FPP_EXPENSIVE"
+			return;
+		}
+
+		if(ctx.getChildCount() != 4) {
+			System.err.println("ERROR: Wrong use of FPP_EXPENSIVE(1). Aborting");
+			System.exit(-1);
+		}
+
+		if(depth != 0) {
+			abort("FPP_EXPENSIVE is under data-dependent control flow");
+		}
+
+		debug.println("Found FPP_EXPENSIVE. Ending stage " + numStages);
+		rewriter.replace(start, "__builtin_prefetch");
+		rewriter.insertBefore(stop, ", 0, 0");
+
+		// Find the ";" after the FPP_EXPENSIVE statement. Valid AST ensures that
+		// there is one
+		int semicolonIndex = stop;
+		for(; semicolonIndex < tokens.size(); semicolonIndex ++) {
+			if(tokens.get(semicolonIndex).getText().contentEquals(";")) {
+				break;
+			}
+		}
+
+		rewriter.insertAfter(semicolonIndex, "\n\t}\n\n\t" + stageLoop + "\n");
+		numStages ++;
+	}
+}
@@ -35,6 +35,21 @@ class Debug {
 		return ret;
 	}
 	
+	// The name of a function definition, or null if its declarator has none
+	// that the grammar understands. The parser recovers from declarators it
+	// cannot parse, like (*f)(int), with rule contexts that miss children.
+	public String functionName(CParser.FunctionDefinitionContext ctx) {
+		if(ctx.declarator() == null) {
+			return null;
+		}
+
+		CParser.DirectDeclaratorContext ddc = ctx.declarator().directDeclarator();
+		while(ddc != null && ddc.Identifier() == null) {
+			ddc = ddc.directDeclarator();
+		}
+		return ddc == null ? null : ddc.Identifier().getText();
+	}
+	
 	// Get a String representation of the input code
 	public String getCode(String gotoFilePath) throws FileNotFoundException {
 		Scanner c = new Scanner(new File(gotoFilePath));
@@ -95,6 +110,11 @@ class VariableDecl {
 		return type + " " + name + "[BATCH_SIZE]" + ";";
 	}
 	
+	// The initializer stays in the code as an assignment (see DeclarationTrimmer)
+	public String scalarDecl() {
+		return type + " " + name + ";";
+	}
+	
 	@Override
 	public boolean equals(Object o) {
 		VariableDecl ov = (VariableDecl) o;
@@ -9,6 +9,7 @@
 #include "ipv4_rtable.h"
 #include "utility.h"
 #include "fpp.h"
+#include "arena.h"
 
 struct ipv4_rtable_writeable_entry {
     unsigned entry_id;
@@ -19,6 +20,11 @@ struct ipv4_rtable_writeable_entry {
 };
 
 static struct ipv4_rtable_writeable_entry *head;
+
+// Writeable entries only live while building, so they come from an arena
+// on the builder's socket that is released in one shot by dispose_entry()
+static struct arena entry_arena;
+
 static uint64_t total_memory_accesses = 0;
 static uint64_t total_queries = 0;
 
@@ -28,9 +34,9 @@ static uint64_t total_catapults = 0;
 static struct ipv4_rtable_writeable_entry *
 ipv4_rtable_writeable_entry_alloc(unsigned *entry_id, uint8_t port_id)
 {
-    struct ipv4_rtable_writeable_entry *entry = (struct ipv4_rtable_writeable_entry *) malloc(sizeof(struct ipv4_rtable_writeable_entry));
+    // Arena memory is already zeroed
+    struct ipv4_rtable_writeable_entry *entry = (struct ipv4_rtable_writeable_entry *) arena_alloc(&entry_arena, sizeof(struct ipv4_rtable_writeable_entry));
 
-    memset(entry, 0, sizeof(struct ipv4_rtable_writeable_entry));
     entry->entry_id = (*entry_id)++;
     entry->port_id = port_id;
     entry->prev = entry->next = NULL;
@@ -53,13 +59,8 @@ append_entry(struct ipv4_rtable_writeable_entry *entry)
 static void
 dispose_entry()
 {
-    struct ipv4_rtable_writeable_entry *entry = head;
-
-    while (entry) {
-        struct ipv4_rtable_writeable_entry *next_entry = entry->next;
-        free(entry);
-        entry = next_entry;
-    }
+    arena_free_all(&entry_arena);
+    head = NULL;
 }
 
 struct ipv4_rtable *
@@ -71,6 +72,7 @@ ipv4_rtable_create(struct ipv4_rib_entry *rib_entries, unsigned n, uint8_t fallb
     struct ipv4_rtable_writeable_entry *root_entry, *entry;
 
     head = NULL;
+    arena_init(&entry_arena, arena_this_socket());
     root_entry = ipv4_rtable_writeable_entry_alloc(&num_entries, fallback_port_id);
     append_entry(root_entry);
 
@@ -3,6 +3,34 @@
 #include<assert.h>
 
 #include "ds_queue.h"
+#include "arena.h"
+
+/**< All queue nodes come from one arena, on the socket of the first thread
+  *  that builds queues. Removed nodes are recycled through a free list, and
+  *  ds_queue_free_all() releases every node at once. */
+static struct arena ds_arena;
+static int ds_arena_inited = 0;
+static struct ds_qnode *ds_free_nodes = NULL;
+
+static struct ds_qnode *ds_qnode_alloc(void)
+{
+	struct ds_qnode *node;
+
+	if(ds_free_nodes != NULL) {
+		node = ds_free_nodes;
+		ds_free_nodes = node->next;
+		return node;
+	}
+
+	if(!ds_arena_inited) {
+		arena_init(&ds_arena, arena_this_socket());
+		ds_arena_inited = 1;
+	}
+
+	node = arena_alloc(&ds_arena, sizeof(struct ds_qnode));
+	assert(node != NULL);
+	return node;
+}
 
 void ds_queue_init(struct ds_queue *q)
 {
@@ -17,8 +45,7 @@ void ds_queue_add(struct ds_queue *q, int data)
 	ds_queue_printf("ds_queue: Adding data %d to ds_queue %p\n", data, q);
 
 	/* Create a new null-terminated node */
-	struct ds_qnode *new_node = malloc(sizeof(struct ds_qnode));
-	assert(new_node != NULL);
+	struct ds_qnode *new_node = ds_qnode_alloc();
 
 	new_node->data = data;
 	new_node->next = NULL;
@@ -54,7 +81,8 @@ int ds_queue_remove(struct ds_queue *q)
 		q->tail = NULL;
 	}
 
-	free(old_head);
+	old_head->next = ds_free_nodes;
+	ds_free_nodes = old_head;
 
 	return data;
 }
@@ -80,6 +108,16 @@ void ds_queue_free(struct ds_queue *q)
 	}
 }
 
+void ds_queue_free_all(void)
+{
+	if(ds_arena_inited) {
+		arena_print_stats(&ds_arena, "ds_queue");
+		arena_free_all(&ds_arena);
+	}
+
+	ds_free_nodes = NULL;
+}
+
 void ds_queue_print(struct ds_queue *q)
 {
 	assert(q != NULL);
@@ -24,3 +24,7 @@ int ds_queue_size(struct ds_queue *q);
 void ds_queue_free(struct ds_queue *q);
 inline int ds_queue_is_empty(const struct ds_queue *q);
 void ds_queue_print(struct ds_queue *q);
+
+/**< Release the nodes of all queues at once. Every queue's nodes become
+  *  invalid, but its count remains readable. */
+void ds_queue_free_all(void);
@@ -337,6 +337,9 @@ int main(int argc, char *argv[])
 		aho_preprocess_dfa(&dfa_arr[i]);
 	}
 
+	/* Only output.count is used after preprocessing, so drop the queues */
+	ds_queue_free_all();
+
 	red_printf("Reading packets from file\n");
 	pkts = aho_get_pkts(AHO_PACKET_FILE, &num_pkts);
 	
@@ -0,0 +1,159 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <numa.h>
+#include <numaif.h>
+
+#include "arena.h"
+
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+
+#define ARENA_HDR_SIZE ((sizeof(struct arena_chunk) + ARENA_ALIGN - 1) & \
+	~((size_t) ARENA_ALIGN - 1))
+
+int arena_this_socket(void)
+{
+	int socket_id = numa_available() < 0 ? 0 : numa_node_of_cpu(sched_getcpu());
+	return socket_id < 0 ? 0 : socket_id;
+}
+
+void arena_init(struct arena *a, int socket_id)
+{
+	assert(a != NULL);
+
+	a->chunks = NULL;
+	a->cur = NULL;
+	a->left = 0;
+	a->socket_id = socket_id;
+
+	a->bytes_alloc = 0;
+	a->num_chunks = 0;
+	a->num_hugepage_chunks = 0;
+}
+
+/**< Map a new chunk with room for at least size bytes after the header.
+  *  Fall back to regular pages if no hugepages are reserved. */
+static void arena_add_chunk(struct arena *a, size_t size)
+{
+	size_t hdr_size = ARENA_HDR_SIZE;
+	size_t chunk_size = ARENA_CHUNK_SIZE;
+	while(chunk_size < hdr_size + size) {
+		chunk_size += ARENA_HUGEPAGE_SIZE;
+	}
+
+	int is_hugepage = 1;
+	void *buf = mmap(NULL, chunk_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+	if(buf == MAP_FAILED) {
+		is_hugepage = 0;
+		buf = mmap(NULL, chunk_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		assert(buf != MAP_FAILED);
+	}
+
+	/**< Bind the chunk to this socket before it is touched */
+	if(a->socket_id >= 0) {
+		const unsigned long nodemask = (1UL << a->socket_id);
+		if(mbind(buf, chunk_size, MPOL_BIND, &nodemask, 64, 0) != 0) {
+			fprintf(stderr, "arena: mbind() to socket %d failed. "
+				"Memory is not NUMA-placed.\n", a->socket_id);
+			perror("mbind");
+		}
+	}
+
+	struct arena_chunk *chunk = (struct arena_chunk *) buf;
+	chunk->next = a->chunks;
+	chunk->size = chunk_size;
+	chunk->is_hugepage = is_hugepage;
+
+	a->chunks = chunk;
+	a->cur = (char *) buf + hdr_size;
+	a->left = chunk_size - hdr_size;
+
+	a->num_chunks ++;
+	a->num_hugepage_chunks += is_hugepage;
+}
+
+void *arena_alloc(struct arena *a, size_t size)
+{
+	assert(a != NULL);
+	size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+
+	/**< The unused tail of the current chunk is wasted */
+	if(size > a->left) {
+		arena_add_chunk(a, size);
+	}
+
+	/**< Anonymous mappings are zero-filled, and memory is never reused */
+	void *ret = a->cur;
+	a->cur += size;
+	a->left -= size;
+	a->bytes_alloc += size;
+
+	return ret;
+}
+
+void *arena_realloc(struct arena *a, void *ptr, size_t old_size, size_t size)
+{
+	assert(a != NULL && a->chunks != NULL);
+	old_size = (old_size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+	size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+	assert(size >= old_size);
+
+	/**< The newest allocation can grow in place */
+	int is_newest = ((char *) ptr + old_size == a->cur);
+	if(is_newest && size - old_size <= a->left) {
+		a->cur += size - old_size;
+		a->left -= size - old_size;
+		a->bytes_alloc += size - old_size;
+		return ptr;
+	}
+
+	/**< If ptr is the only allocation in its chunk, the chunk is unmapped
+	  *  once the data has moved to the new chunk */
+	struct arena_chunk *old_chunk = a->chunks;
+	int is_alone = is_newest && ((char *) old_chunk + ARENA_HDR_SIZE == ptr);
+
+	void *ret = arena_alloc(a, size);
+	memcpy(ret, ptr, old_size);
+
+	if(is_alone) {
+		assert(a->chunks->next == old_chunk);
+		a->chunks->next = old_chunk->next;
+		a->num_chunks --;
+		a->num_hugepage_chunks -= old_chunk->is_hugepage;
+		a->bytes_alloc -= old_size;
+		munmap(old_chunk, old_chunk->size);
+	}
+
+	return ret;
+}
+
+void arena_free_all(struct arena *a)
+{
+	assert(a != NULL);
+
+	struct arena_chunk *chunk = a->chunks;
+	while(chunk != NULL) {
+		struct arena_chunk *next = chunk->next;
+		munmap(chunk, chunk->size);
+		chunk = next;
+	}
+
+	arena_init(a, a->socket_id);
+}
+
+void arena_print_stats(struct arena *a, const char *name)
+{
+	printf("arena %s: %.2f MB allocated in %d chunks (%d on hugepages)\n",
+		name, (double) a->bytes_alloc / (1024 * 1024),
+		a->num_chunks, a->num_hugepage_chunks);
+}
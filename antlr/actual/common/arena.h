@@ -0,0 +1,47 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+/**< A bump allocator for build-time structures. Memory is carved out of
+  *  large chunks that are backed by 2 MB hugepages when available and bound
+  *  to a NUMA socket. Objects are never freed individually: arena_free_all()
+  *  releases every chunk at once. */
+#define ARENA_CHUNK_SIZE (32 * 1024 * 1024)	/**< Multiple of 2 MB */
+#define ARENA_HUGEPAGE_SIZE (2 * 1024 * 1024)
+#define ARENA_ALIGN 16
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;			/**< Mapped bytes, including this header */
+	int is_hugepage;
+};
+
+struct arena {
+	struct arena_chunk *chunks;		/**< Newest chunk first */
+	char *cur;				/**< Bump pointer in the newest chunk */
+	size_t left;			/**< Bytes left in the newest chunk */
+	int socket_id;			/**< -1 for no NUMA binding */
+
+	/**< Stats */
+	size_t bytes_alloc;
+	int num_chunks;
+	int num_hugepage_chunks;
+};
+
+void arena_init(struct arena *a, int socket_id);
+
+/**< The socket of the CPU that the caller runs on */
+int arena_this_socket(void);
+
+/**< Returns zeroed, ARENA_ALIGN-aligned memory */
+void *arena_alloc(struct arena *a, size_t size);
+
+/**< Grow an allocation. The newest allocation grows in place when its chunk
+  *  has room, and a chunk that only held the old copy is unmapped, so growing
+  *  one array by doubling does not leave its old copies in the arena. */
+void *arena_realloc(struct arena *a, void *ptr, size_t old_size, size_t size);
+void arena_free_all(struct arena *a);
+void arena_print_stats(struct arena *a, const char *name);
+
+#endif /* __ARENA_H__ */
@@ -0,0 +1,87 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<pthread.h>
+#include<time.h>
+#include<unistd.h>
+
+#include "fpp.h"
+#include "cuckoo.h"
+#include "autosel.h"
+
+/** < Keys used to pick the first variant at startup */
+#define AUTOSEL_SAMPLE_KEYS (64 * 1024)
+
+/** < Built from nogoto.c, goto.c and handopt.c with -DAUTOSEL */
+int process_batch_nogoto(int *key_lo);
+int process_batch_goto(int *key_lo);
+int process_batch_handopt(int *key_lo);
+
+void *cuckoo_thread(void *arg)
+{
+	int i;
+	int id = *((int *) (arg));
+	int tot_val_sum = 0;
+	struct autosel sel;
+
+	autosel_init(&sel);
+	autosel_add(&sel, "nogoto", process_batch_nogoto);
+	autosel_add(&sel, "goto", process_batch_goto);
+	autosel_add(&sel, "handopt", process_batch_handopt);
+
+	red_printf("Thread %d: Calibrating variants\n", id);
+	autosel_calibrate(&sel, keys, AUTOSEL_SAMPLE_KEYS);
+	autosel_print_stats(&sel, id);
+
+	red_printf("Thread %d: Starting lookups\n", id);
+
+	struct timespec start, end;
+
+	while(1) {
+		clock_gettime(CLOCK_REALTIME, &start);
+
+		for(i = 0; i < NUM_KEYS; i += BATCH_SIZE) {
+			tot_val_sum += autosel_process_batch(&sel, &keys[i]);
+		}
+
+		clock_gettime(CLOCK_REALTIME, &end);
+		double seconds = (end.tv_sec - start.tv_sec) +
+			(double) (end.tv_nsec - start.tv_nsec) / 1000000000;
+
+		red_printf("Thread ID: %d, Rate = %.2f M/s. Value sum = %d\n",
+			id, NUM_KEYS / (seconds * 1000000), tot_val_sum);
+		autosel_print_stats(&sel, id);
+	}
+
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	assert(argc == 2);
+	int num_threads = atoi(argv[1]);
+	assert(num_threads >= 1 && num_threads <= CUCKOO_MAX_THREADS);
+
+	red_printf("main: Initializing shared cuckoo hash table\n");
+	cuckoo_init(&keys, &ht_index);
+
+	/**< Thread structures */
+	pthread_t worker_threads[CUCKOO_MAX_THREADS];
+
+	for(i = 0; i < num_threads; i ++) {
+		int tid = i;
+		pthread_create(&worker_threads[i], NULL, cuckoo_thread, &tid);
+
+		/**< Ensure that threads don't use the same keys close in time */
+		sleep(1);
+	}
+
+	for(i = 0; i < num_threads; i ++) {
+		pthread_join(worker_threads[i], NULL);
+	}
+
+	/**< The work never ends */
+	assert(0);
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "fpp.h"
+#include "autosel.h"
+
+static inline long long autosel_rdtsc(void)
+{
+	unsigned low, high;
+	asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+	return ((long long) high << 32) | low;
+}
+
+void autosel_init(struct autosel *s)
+{
+	s->num_variants = 0;
+	s->cur = 0;
+	s->probe_variant = -1;
+	s->probe_batches = 0;
+	s->batches_since_probe = 0;
+	s->num_probes = 0;
+	s->num_switches = 0;
+}
+
+void autosel_add(struct autosel *s, const char *name,
+	int (*process_batch)(int *key_lo))
+{
+	assert(s->num_variants < AUTOSEL_MAX_VARIANTS);
+
+	struct autosel_variant *v = &s->variants[s->num_variants ++];
+	v->name = name;
+	v->process_batch = process_batch;
+	v->cycles_per_batch = 0;
+	v->num_batches = 0;
+}
+
+/** < Switch to the variant with the lowest cost in the last probe */
+static void autosel_pick(struct autosel *s)
+{
+	int i, best = 0;
+
+	for(i = 1; i < s->num_variants; i ++) {
+		if(s->variants[i].cycles_per_batch <
+			s->variants[best].cycles_per_batch) {
+			best = i;
+		}
+	}
+
+	if(best != s->cur && s->variants[best].cycles_per_batch <
+		(1 - AUTOSEL_MIN_GAIN) * s->variants[s->cur].cycles_per_batch) {
+		s->num_switches ++;
+		s->cur = best;
+	}
+
+	s->num_probes ++;
+}
+
+void autosel_calibrate(struct autosel *s, int *keys, int num_keys)
+{
+	int i, v;
+	assert(s->num_variants > 0 && num_keys >= BATCH_SIZE);
+
+	/** < Warm up so that the first variant is not charged for cold misses */
+	for(i = 0; i + BATCH_SIZE <= num_keys; i += BATCH_SIZE) {
+		s->variants[0].process_batch(&keys[i]);
+	}
+
+	for(v = 0; v < s->num_variants; v ++) {
+		int num_batches = 0;
+		long long start = autosel_rdtsc();
+
+		for(i = 0; i + BATCH_SIZE <= num_keys; i += BATCH_SIZE) {
+			s->variants[v].process_batch(&keys[i]);
+			num_batches ++;
+		}
+
+		s->variants[v].cycles_per_batch =
+			(double) (autosel_rdtsc() - start) / num_batches;
+	}
+
+	autosel_pick(s);
+}
+
+int autosel_process_batch(struct autosel *s, int *key_lo)
+{
+	int ret;
+
+	if(s->probe_variant == -1) {
+		ret = s->variants[s->cur].process_batch(key_lo);
+		s->variants[s->cur].num_batches ++;
+
+		if(++ s->batches_since_probe == AUTOSEL_RECHECK_BATCHES) {
+			s->probe_variant = 0;
+			s->probe_batches = 0;
+			s->probe_start = autosel_rdtsc();
+		}
+
+		return ret;
+	}
+
+	/** < Probing: run each variant for AUTOSEL_PROBE_BATCHES batches */
+	struct autosel_variant *v = &s->variants[s->probe_variant];
+	ret = v->process_batch(key_lo);
+
+	if(++ s->probe_batches == AUTOSEL_PROBE_BATCHES) {
+		long long now = autosel_rdtsc();
+		v->cycles_per_batch =
+			(double) (now - s->probe_start) / AUTOSEL_PROBE_BATCHES;
+
+		s->probe_variant ++;
+		s->probe_batches = 0;
+		s->probe_start = now;
+
+		if(s->probe_variant == s->num_variants) {
+			s->probe_variant = -1;
+			s->batches_since_probe = 0;
+			autosel_pick(s);
+		}
+	}
+
+	return ret;
+}
+
+const char *autosel_current(struct autosel *s)
+{
+	return s->variants[s->cur].name;
+}
+
+void autosel_print_stats(struct autosel *s, int thread_id)
+{
+	int i;
+
+	printf("Thread %d: using %s. Probes = %d, switches = %d\n", thread_id,
+		autosel_current(s), s->num_probes, s->num_switches);
+
+	for(i = 0; i < s->num_variants; i ++) {
+		printf("\t%s: %.1f cycles/batch in last probe, %lld batches run\n",
+			s->variants[i].name, s->variants[i].cycles_per_batch,
+			s->variants[i].num_batches);
+	}
+}
@@ -0,0 +1,59 @@
+/** < Runtime selection among the compiled variants (nogoto, goto, handopt)
+  * of process_batch(). A selector times every variant on the live inputs
+  * and runs the fastest one. It probes again every AUTOSEL_RECHECK_BATCHES
+  * batches, because the best variant depends on how much of the table fits
+  * in cache and on whether hyperthreads already provide MLP. Selectors are
+  * per-thread and need no locking. */
+#define AUTOSEL_MAX_VARIANTS 4
+
+/** < Batches timed for each variant in a probe */
+#define AUTOSEL_PROBE_BATCHES 4096
+
+/** < A probe switches variants only if the new one is this much faster, so
+  * that nearly equal variants do not flap */
+#define AUTOSEL_MIN_GAIN 0.05
+
+/** < Batches between probes */
+#define AUTOSEL_RECHECK_BATCHES (16 * 1024 * 1024)
+
+struct autosel_variant {
+	const char *name;
+	int (*process_batch)(int *key_lo);
+
+	/** < Stats */
+	double cycles_per_batch;	/** < From the most recent probe */
+	long long num_batches;		/** < Batches run outside probes */
+};
+
+struct autosel {
+	struct autosel_variant variants[AUTOSEL_MAX_VARIANTS];
+	int num_variants;
+	int cur;				/** < The variant in use */
+
+	/** < Probe state. probe_variant is -1 when not probing. */
+	int probe_variant;
+	int probe_batches;
+	long long probe_start;
+	long long batches_since_probe;
+
+	/** < Stats */
+	int num_probes;
+	int num_switches;
+};
+
+void autosel_init(struct autosel *s);
+void autosel_add(struct autosel *s, const char *name,
+	int (*process_batch)(int *key_lo));
+
+/** < Probe all variants on num_keys sample keys and pick the fastest. Used
+  * at startup, before live inputs arrive. */
+void autosel_calibrate(struct autosel *s, int *keys, int num_keys);
+
+/** < Process a batch with the chosen variant, probing when it is time */
+int autosel_process_batch(struct autosel *s, int *key_lo);
+
+/** < The name of the variant in use */
+const char *autosel_current(struct autosel *s);
+
+/** < Print the choice and the most recent per-variant costs */
+void autosel_print_stats(struct autosel *s, int thread_id);
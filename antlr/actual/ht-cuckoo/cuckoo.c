@@ -1,5 +1,8 @@
 #include "cuckoo.h"
 
+int *keys;
+struct cuckoo_bkt *ht_index;
+
 int hash(int u)
 {
 	return CityHash32((char *) &u, 4);
@@ -40,6 +40,10 @@ struct cuckoo_bkt
 	struct cuckoo_slot slot[8];
 };
 
+/** < The keys and the index, shared by all threads */
+extern int *keys;
+extern struct cuckoo_bkt *ht_index;
+
 int hash(int u);
 void cuckoo_init(int **keys, struct cuckoo_bkt** ht_index);
 void red_printf(const char *format, ...);
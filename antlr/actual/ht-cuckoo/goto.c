@@ -7,9 +7,6 @@
 #include "fpp.h"
 #include "cuckoo.h"
 
-int *keys;
-struct cuckoo_bkt *ht_index;
-
 int process_batch(int *key_lo)
 {
 	int val_sum = 0;
@@ -73,6 +70,9 @@ fpp_end:
 	
 }
 
+/** < With AUTOSEL, only process_batch() is compiled, and auto.c runs it
+  * alongside the other variants */
+#ifndef AUTOSEL
 void *cuckoo_thread(void *arg)
 {
 	int i;
@@ -131,3 +131,4 @@ int main(int argc, char **argv)
 
 	return 0;
 }
+#endif
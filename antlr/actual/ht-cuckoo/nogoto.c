@@ -7,9 +7,6 @@
 #include "fpp.h"
 #include "cuckoo.h"
 
-int *keys;
-struct cuckoo_bkt *ht_index;
-
 int process_batch(int *key_lo) 
 {
 	int batch_index = 0;
@@ -47,6 +44,9 @@ int process_batch(int *key_lo)
 	return val_sum;
 }
 
+/** < With AUTOSEL, only process_batch() is compiled, and auto.c runs it
+  * alongside the other variants */
+#ifndef AUTOSEL
 void *cuckoo_thread(void *arg)
 {
 	int i;
@@ -105,3 +105,4 @@ int main(int argc, char **argv)
 
 	return 0;
 }
+#endif
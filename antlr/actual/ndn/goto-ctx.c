@@ -0,0 +1,192 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<pthread.h>
+#include<papi.h>
+#include<time.h>
+
+#include "city.h"
+#include "fpp.h"
+#include "ndn.h"
+
+int batch_index = 0;
+
+void process_batch(struct ndn_name *name_lo, int *dst_ports,
+	struct ndn_bucket *ht) 
+{
+	struct fpp_ctx {
+		char *name;
+		int c_i;
+		int i;
+		int bkt_num;
+		int bkt_1;
+		int bkt_2;
+		int terminate;
+		int prefix_match_found;
+		uint64_t prefix_hash;
+		uint16_t tag;
+		struct ndn_slot *slots;
+		int8_t _dst_port;
+		uint64_t _hash;
+	} __attribute__((aligned(64)));
+	struct fpp_ctx ctx[BATCH_SIZE];
+
+	int I = 0;			// batch index
+	void *batch_rips[BATCH_SIZE];		// goto targets
+	int iMask = 0;		// No packet is done yet
+
+	int temp_index;
+	for(temp_index = 0; temp_index < BATCH_SIZE; temp_index ++) {
+		batch_rips[temp_index] = &&fpp_start;
+	}
+
+fpp_start:
+
+		ctx[I].name = name_lo[I].name;
+		if(I != BATCH_SIZE - 1) {
+			__builtin_prefetch(name_lo[I + 1].name, 0, 3);
+		}
+
+			/**< URL char iterator and slot iterator */
+		
+		ctx[I].terminate = 0;			/**< Stop processing this URL? */
+		ctx[I].prefix_match_found = 0;	/**< Stop this hash-table lookup ? */
+
+		/**< For names that we cannot find, dst_port is -1 */
+		dst_ports[I] = -1;
+
+		for(ctx[I].c_i = 0; ctx[I].name[ctx[I].c_i] != 0; ctx[I].c_i ++) {
+			if(ctx[I].name[ctx[I].c_i] == '/') {
+				break;
+			}
+		}
+
+		ctx[I].c_i ++;
+		for(; ctx[I].name[ctx[I].c_i] != 0; ctx[I].c_i ++) {
+			if(ctx[I].name[ctx[I].c_i] != '/') {
+				continue;
+			}
+
+			ctx[I].prefix_hash = CityHash64WithSeed(ctx[I].name, ctx[I].c_i + 1, NDN_SEED);
+			ctx[I].tag = ctx[I].prefix_hash >> 48;
+
+			/**< name[0] -> name[c_i] is a prefix of length c_i + 1 */
+			for(ctx[I].bkt_num = 1; ctx[I].bkt_num <= 2; ctx[I].bkt_num ++) {
+				if(ctx[I].bkt_num == 1) {
+					ctx[I].bkt_1 = ctx[I].prefix_hash & NDN_NUM_BKT_;
+					FPP_PSS(&ht[ctx[I].bkt_1], fpp_label_1);
+fpp_label_1:
+
+					ctx[I].slots = ht[ctx[I].bkt_1].slots;
+				} else {
+					ctx[I].bkt_2 = (ctx[I].bkt_1 ^ CityHash64((char *) &ctx[I].tag, 2)) & NDN_NUM_BKT_;
+					FPP_PSS(&ht[ctx[I].bkt_2], fpp_label_2);
+fpp_label_2:
+
+					ctx[I].slots = ht[ctx[I].bkt_2].slots;
+				}
+
+				/**< Now, "slots" points to an ndn_bucket. Find a valid slot
+				  *  with a matching tag. */
+				for(ctx[I].i = 0; ctx[I].i < NDN_NUM_SLOTS; ctx[I].i ++) {
+					ctx[I]._dst_port = ctx[I].slots[ctx[I].i].dst_port;
+					ctx[I]._hash = ctx[I].slots[ctx[I].i].cityhash;
+
+					if(ctx[I]._dst_port >= 0 && ctx[I]._hash == ctx[I].prefix_hash) {
+
+						/**< Record the dst port: this may get overwritten by
+						  *  longer prefix matches later */
+						dst_ports[I] = ctx[I].slots[ctx[I].i].dst_port;
+
+						if(ctx[I].slots[ctx[I].i].is_terminal == 1) {
+							/**< A terminal FIB entry: we're done! */
+							ctx[I].terminate = 1;
+						}
+
+						ctx[I].prefix_match_found = 1;
+						break;
+					}
+				}
+
+				/**< Stop the hash-table lookup for name[0 ... c_i] */
+				if(ctx[I].prefix_match_found == 1) {
+					break;
+				}
+			}
+
+			/**< Stop processing the name if we found a terminal FIB entry */
+			if(ctx[I].terminate == 1) {
+				break;
+			}
+		}	/**< Loop over URL characters ends here */
+	
+		/**< Loop over batch ends here */
+
+fpp_end:
+	batch_rips[I] = &&fpp_end;
+	iMask = FPP_SET(iMask, I); 
+	if(iMask == (1 << BATCH_SIZE) - 1) {
+		return;
+	}
+	I = (I + 1) < BATCH_SIZE ? I + 1 : 0;
+	goto *batch_rips[I];
+
+}
+
+
+int main(int argc, char **argv)
+{
+	printf("%lu\n", sizeof(struct ndn_bucket));
+	struct ndn_bucket *ht;
+	int i, j;
+	int dst_ports[BATCH_SIZE], nb_succ = 0, dst_port_sum = 0;
+
+	/** < Variables for PAPI */
+	float real_time, proc_time, ipc;
+	long long ins;
+	int retval;
+
+	red_printf("main: Initializing NDN hash table\n");
+	ndn_init(URL_FILE, 0xf, &ht);
+	red_printf("\tmain: Setting up NDN index done!\n");
+
+	red_printf("main: Getting name array for lookups\n");
+	int nb_names = ndn_get_num_lines(NAME_FILE);
+	nb_names = nb_names - (nb_names % BATCH_SIZE);	/**< Align input to batch */
+
+	struct ndn_name *name_arr = ndn_get_name_array(NAME_FILE);
+	red_printf("\tmain: Constructed name array!\n");
+
+	red_printf("main: Starting NDN lookups\n");
+
+	/** < Init PAPI_TOT_INS and PAPI_TOT_CYC counters */
+	if((retval = PAPI_ipc(&real_time, &proc_time, &ins, &ipc)) < PAPI_OK) {
+		printf("PAPI error: retval: %d\n", retval);
+		exit(1);
+	}
+
+	for(i = 0; i < nb_names; i += BATCH_SIZE) {
+		memset(dst_ports, -1, BATCH_SIZE * sizeof(int));
+		process_batch(&name_arr[i], dst_ports, ht);
+
+		for(j = 0; j < BATCH_SIZE; j ++) {
+			#if NDN_DEBUG == 1
+			printf("Name %s -> port %d\n", name_arr[i + j].name, dst_ports[j]);
+			#endif
+			nb_succ += (dst_ports[j] == -1) ? 0 : 1;
+			dst_port_sum += dst_ports[j];
+		}
+	}
+
+	if((retval = PAPI_ipc(&real_time, &proc_time, &ins, &ipc)) < PAPI_OK) {
+		printf("PAPI error: retval: %d\n", retval);
+		exit(1);
+	}
+
+	red_printf("Time = %.4f s, Lookup rate = %.2f M/s | nb_succ = %d, sum = %d\n"
+		"Instructions = %lld, IPC = %f\n",
+		real_time, nb_names / (real_time * 1000000), nb_succ, dst_port_sum,
+		ins, ipc);
+
+	return 0;
+}
+
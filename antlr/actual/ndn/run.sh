@@ -14,3 +14,8 @@ blue ""
 blue "Running goto"
 shm-rm.sh 1>/dev/null 2>/dev/null
 sudo taskset -c 0 ./goto
+
+blue ""
+blue "Running goto with per-lookup context structs"
+shm-rm.sh 1>/dev/null 2>/dev/null
+sudo taskset -c 0 ./goto-ctx
@@ -3,6 +3,151 @@
 #include<stdio.h>
 #include<string.h>
 #include<assert.h>
+#include<unistd.h>
+#include<sys/ipc.h>
+#include<sys/shm.h>
+
+#include "param.h"
+#include "fpp.h"
+
+static void mlp_usage(char *prog)
+{
+	fprintf(stderr, "Usage: %s [-c chains] [-d depth] [-l log_cap] "
+		"[-s stride] [-n] [-w width]\n"
+		"\t-c: Number of independent chains (default %d)\n"
+		"\t-d: Dependent hops per chain (default %d)\n"
+		"\t-l: Number of ints in the log, a power of 2 (default %d)\n"
+		"\t-s: Link the log with a fixed stride instead of a random cycle\n"
+		"\t-n: Do not use hugepages\n"
+		"\t-w: Chains in flight, 1 to %d (default %d)\n",
+		prog, NUM_PKTS, DEPTH, LOG_CAP, BATCH_SIZE, BATCH_SIZE);
+	exit(-1);
+}
+
+void mlp_parse_args(int argc, char **argv, struct mlp_params *p)
+{
+	int c;
+
+	p->num_chains = NUM_PKTS;
+	p->depth = DEPTH;
+	p->log_cap = LOG_CAP;
+	p->topology = MLP_RANDOM;
+	p->stride = 0;
+	p->use_hugepages = 1;
+	p->width = BATCH_SIZE;
+
+	while((c = getopt(argc, argv, "c:d:l:s:nw:")) != -1) {
+		switch(c) {
+		case 'c':
+			p->num_chains = atoi(optarg);
+			break;
+		case 'd':
+			p->depth = atoi(optarg);
+			break;
+		case 'l':
+			p->log_cap = atoi(optarg);
+			break;
+		case 's':
+			p->topology = MLP_STRIDE;
+			p->stride = atoi(optarg);
+			break;
+		case 'n':
+			p->use_hugepages = 0;
+			break;
+		case 'w':
+			p->width = atoi(optarg);
+			break;
+		default:
+			mlp_usage(argv[0]);
+		}
+	}
+
+	if(p->num_chains <= 0 || p->depth <= 0 ||
+		p->log_cap <= 0 || (p->log_cap & (p->log_cap - 1)) != 0 ||
+		p->width < 1 || p->width > BATCH_SIZE) {
+		mlp_usage(argv[0]);
+	}
+}
+
+int *mlp_init_log(struct mlp_params *p)
+{
+	int i, j, tmp;
+	int *ht_log;
+	int log_cap_ = p->log_cap - 1;
+
+	// Allocate a large memory area
+	fprintf(stderr, "Size of ht_log = %lu, hugepages = %s\n",
+		p->log_cap * sizeof(int), p->use_hugepages ? "on" : "off");
+
+	int sid = shmget(LOG_SID, p->log_cap * sizeof(int),
+		IPC_CREAT | 0666 | (p->use_hugepages ? SHM_HUGETLB : 0));
+	if(sid < 0) {
+		fprintf(stderr, "Could not create ht_log\n");
+		exit(-1);
+	}
+	ht_log = shmat(sid, 0, 0);
+	assert(ht_log != (void *) -1);
+
+	/**< Remove the segment once we detach so that runs with a different
+	  *  size or page type do not find a stale one */
+	shmctl(sid, IPC_RMID, NULL);
+
+	if(p->topology == MLP_STRIDE) {
+		for(i = 0; i < p->log_cap; i ++) {
+			ht_log[i] = (i + p->stride) & log_cap_;
+		}
+		return ht_log;
+	}
+
+	/**< Sattolo's algorithm: a random permutation with a single cycle, so
+	  *  chains never fall into a short, cache-resident loop */
+	for(i = 0; i < p->log_cap; i ++) {
+		ht_log[i] = i;
+	}
+
+	for(i = p->log_cap - 1; i > 0; i --) {
+		j = (int) (((long long) rand() * RAND_MAX + rand()) % i);
+		tmp = ht_log[i];
+		ht_log[i] = ht_log[j];
+		ht_log[j] = tmp;
+	}
+
+	return ht_log;
+}
+
+int *mlp_init_chains(struct mlp_params *p)
+{
+	int i;
+	int *pkts = (int *) malloc(p->num_chains * sizeof(int));
+	assert(pkts != NULL);
+
+	for(i = 0; i < p->num_chains; i++) {
+		pkts[i] = rand() & (p->log_cap - 1);
+	}
+
+	return pkts;
+}
+
+void mlp_report(const char *variant, struct mlp_params *p, int sum,
+	float real_time, long long ins, float ipc)
+{
+	double num_accesses = (double) p->num_chains * p->depth;
+
+	printf("Sum = %d\n", sum);
+	red_printf("Real_time: %.4fs, rate = %.2f\n"
+		"Total instructions: %lld, Total cycles = %lld, IPC: %f\n", 
+		real_time, p->num_chains / real_time,
+		ins, (long long) (ins / ipc), ipc);
+
+	red_printf("Memory access rate = %.2f M/s\n", 
+		num_accesses / (real_time * 1000000));
+
+	printf("MLP %s width %d depth %d chains %d log_cap %d topology %s "
+		"hugepages %d ns_per_access %.2f\n", variant, p->width, p->depth,
+		p->num_chains, p->log_cap,
+		p->topology == MLP_RANDOM ? "random" : "stride",
+		p->use_hugepages, real_time * 1e9 / num_accesses);
+}
 
 // Like printf, but red. Limited to 1000 characters.
 void red_printf(const char *format, ...)
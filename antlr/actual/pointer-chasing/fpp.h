@@ -1,23 +1,22 @@
 #define FPP_EXPENSIVE(x)	{}					// Just a hint
-#define FPP_ISSET(n, i) (n & (1 << i))
-#define FPP_SET(n, i) (n | (1 << i))	// Set the ith bit of n
-#define FPP_ISSET(n, i) (n & (1 << i))
+#define FPP_ISSET(n, i) (n & (1ULL << i))
+#define FPP_SET(n, i) (n | (1ULL << i))	// Set the ith bit of n
 	
-// Prefetch, Save, and Switch
-#define FPP_PSS(addr, label) \
+// Prefetch, Save, and Switch among the first batch_size items
+#define FPP_PSS(addr, label, batch_size) \
 do {\
 	__builtin_prefetch(addr, 0, 0); \
 	batch_rips[I] = &&label; \
-	I = (I + 1) & BATCH_SIZE_;	\
+	I = (I + 1) < batch_size ? I + 1 : 0; \
 	goto *batch_rips[I]; \
 } while(0)
 
-#define BATCH_SIZE 8
-#define BATCH_SIZE_ 7
+// The largest interleave width. Batch masks are 64-bit.
+#define BATCH_SIZE 32
 
 #define foreach(i, n) for(i = 0; i < n; i ++)
 
-long long get_cycles()
+static inline long long get_cycles()
 {
 	unsigned low, high;
 	unsigned long long val;
@@ -0,0 +1,35 @@
+# Measure ns per access against the number of chains in flight (the
+# interleave width) for nogoto, goto and handopt. Extra arguments are
+# passed to every run, for example:
+#	./mlp-sweep.sh -d 100 -l 4194304 -n
+# The table is printed and saved to results/mlp/mlp.dat.
+
+# A function to echo in blue color
+function blue() {
+	es=`tput setaf 4`
+	ee=`tput sgr0`
+	echo "${es}$1${ee}"
+}
+
+WIDTHS="1 2 3 4 5 6 7 8 10 12 14 16 20 24 28 32"
+OUT=results/mlp/mlp.dat
+
+shm-rm.sh 1>/dev/null 2>/dev/null
+mkdir -p results/mlp
+
+blue "MLP sweep with args: $@"
+
+echo "# args: $@" > $OUT
+echo "# WIDTH		nogoto		goto		handopt" >> $OUT
+
+for width in $WIDTHS; do
+	line="$width"
+	for variant in nogoto goto handopt; do
+		ns=`sudo numactl --physcpubind 0 --interleave 0 ./$variant -w $width "$@" \
+			2>/dev/null | grep -a "MLP " | awk '{print $NF}'`
+		line="$line		$ns"
+	done
+	echo "$line" >> $OUT
+done
+
+cat $OUT
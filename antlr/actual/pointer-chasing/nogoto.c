@@ -3,34 +3,37 @@
 #include<pthread.h>
 #include<papi.h>
 #include<time.h>
-#include<sys/ipc.h>
-#include<sys/shm.h>
 
 #include "param.h"
 #include "fpp.h"
 
 int *ht_log;
 
-// Each packet contains a random integer
+// Each packet contains a random integer: the start of its chain
 int *pkts;
 
 int sum = 0;
 
+// Runtime parameters used by the lookups
+int depth;
+
 // batch_index must be declared outside process_pkts_in_batch
 int batch_index = 0;
 
-// Process BATCH_SIZE pkts starting from lo
-int process_pkts_in_batch(int *pkt_lo)
+#define VARIANT "nogoto"
+
+// Process n <= BATCH_SIZE pkts starting from lo
+void process_pkts_in_batch(int *pkt_lo, int n)
 {
 	// Like a foreach loop
-	foreach(batch_index, BATCH_SIZE) {
+	foreach(batch_index, n) {
 		
 		int i;
 		int jumper = pkt_lo[batch_index];
 			
-		for(i = 0; i < DEPTH; i++) {
+		for(i = 0; i < depth; i++) {
 			FPP_EXPENSIVE(&ht_log[jumper]);
-			jumper = (ht_log[jumper] + i) & LOG_CAP_;
+			jumper = ht_log[jumper];
 		}
 
 		sum += jumper;
@@ -39,32 +42,18 @@ int process_pkts_in_batch(int *pkt_lo)
 
 int main(int argc, char **argv)
 {
-	int i, j, retval;
+	int i, retval;
+	struct mlp_params p;
 
 	// Variables for PAPI
 	float real_time, proc_time, ipc;
 	long long ins;
 
-	// Allocate a large memory area
-	fprintf(stderr, "Size of ht_log = %lu\n", LOG_CAP * sizeof(int));
-
-	int sid = shmget(LOG_SID, LOG_CAP * sizeof(int), IPC_CREAT | 0666 | SHM_HUGETLB);
-	if(sid < 0) {
-		fprintf(stderr, "Could not create ht_log\n");
-		exit(-1);
-	}
-	ht_log = shmat(sid, 0, 0);
-
-	// Fill in the ht_log with index into itself
-	for(i = 0; i < LOG_CAP; i ++) {
-		ht_log[i] = rand() & LOG_CAP_;
-	}
+	mlp_parse_args(argc, argv, &p);
+	depth = p.depth;
 
-	// Allocate the packets
-	pkts = (int *) malloc(NUM_PKTS * sizeof(int));
-	for(i = 0; i < NUM_PKTS; i++) {
-		pkts[i] = rand() & LOG_CAP_;
-	}
+	ht_log = mlp_init_log(&p);
+	pkts = mlp_init_chains(&p);
 
 	fprintf(stderr, "Finished creating ht_log and packets\n");
 
@@ -74,8 +63,10 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 	
-	for(i = 0; i < NUM_PKTS; i += BATCH_SIZE) {
-		process_pkts_in_batch(&pkts[i]);
+	// The last group has the remaining chains if width does not divide them
+	for(i = 0; i < p.num_chains; i += p.width) {
+		process_pkts_in_batch(&pkts[i],
+			p.num_chains - i < p.width ? p.num_chains - i : p.width);
 	}
 
 	if((retval = PAPI_ipc(&real_time, &proc_time, &ins, &ipc)) < PAPI_OK) {    
@@ -83,12 +74,6 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
-	printf("Sum = %d\n", sum);
-	red_printf("Real_time: %.4fs, rate = %.2f\n"
-		"Total instructions: %lld, Total cycles = %lld, IPC: %f\n", 
-		real_time, NUM_PKTS / real_time,
-		ins, (long long ) (ins / ipc), ipc);
-
-	red_printf("Memory access rate = %.2f M/s\n", 
-		(NUM_PKTS * DEPTH) / (real_time * 1000000));
+	mlp_report(VARIANT, &p, sum, real_time, ins, ipc);
+	return 0;
 }
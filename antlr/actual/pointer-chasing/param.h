@@ -1,20 +1,37 @@
+/**< Defaults. All of these can be overridden on the command line, see
+  *  mlp_usage() in common.c. */
 #define DEPTH 100
 #define NUM_PKTS (64 * 1024)
 
 #define LOG_SID 1
 
-/**< 1 GB: DRAM */
+/**< 1 GB: DRAM. Use -l 4194304 for L3 (16 MB), -l 65536 for L2 (256 KB)
+  *  and -l 2048 for L1 (32 KB). */
 #define LOG_CAP (256 * 1024 * 1024)		// Number of ints in the log
-#define LOG_CAP_ (LOG_CAP - 1)
 
-/**< 16 MB: L3 cache */
-//#define LOG_CAP (4 * 1024 * 1024)			// Number of ints in the log
-//#define LOG_CAP_ (LOG_CAP - 1)
+/**< Chain topologies */
+#define MLP_RANDOM 0	// ht_log is a single random cycle
+#define MLP_STRIDE 1	// ht_log[i] = i + stride
 
-/**< 256K: L2 cache */
-//#define LOG_CAP (64 * 1024)				// Number of ints in the log
-//#define LOG_CAP_ (LOG_CAP - 1)
+struct mlp_params {
+	int num_chains;		// Number of independent chains (packets)
+	int depth;			// Dependent hops per chain
+	int log_cap;		// Number of ints in ht_log, a power of 2
+	int topology;		// MLP_RANDOM or MLP_STRIDE
+	int stride;			// Hop distance in ints for MLP_STRIDE
+	int use_hugepages;
+	int width;			// Chains interleaved, <= BATCH_SIZE
+};
 
-/**< 32K: L1 cache */
-//#define LOG_CAP (2 * 1024)					// Number of ints in the log
-//#define LOG_CAP_ (LOG_CAP - 1)
+void mlp_parse_args(int argc, char **argv, struct mlp_params *p);
+
+/**< Allocate and link ht_log, and pick a random start for every chain */
+int *mlp_init_log(struct mlp_params *p);
+int *mlp_init_chains(struct mlp_params *p);
+
+/**< Print the run's stats, ending with a single "MLP ..." line that
+  *  mlp-sweep.sh parses */
+void mlp_report(const char *variant, struct mlp_params *p, int sum,
+	float real_time, long long ins, float ipc);
+
+void red_printf(const char *format, ...);
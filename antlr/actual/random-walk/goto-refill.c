@@ -0,0 +1,113 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<pthread.h>
+#include<papi.h>
+#include<time.h>
+
+#include "fpp.h"
+#include "rand-walk.h"
+
+struct rand_walk_graph graph;
+
+long long sum = 0;
+
+/** < Walk w starts at node w. Runs walks 0 ... nb_walks - 1, refilling a
+  * slot with the next walk as soon as its walk ends, so the whole pool of
+  * walks goes through BATCH_SIZE slots in one call. */
+void process_walks_refill(int nb_walks)
+{
+	int cur_node[BATCH_SIZE];
+	int degree[BATCH_SIZE];
+	int nbh_lo[BATCH_SIZE];
+	int i[BATCH_SIZE];
+	int nbh[BATCH_SIZE];
+
+	int I = 0;			// batch index
+	void *batch_rips[BATCH_SIZE];		// goto targets
+	int iMask = 0;		// No slot is done yet
+
+	// Slot I works on walk fpp_in[I]. A slot that finishes takes the next
+	// walk instead of idling until the whole batch is done.
+	int fpp_in[BATCH_SIZE];
+	int fpp_next = 0;		// Next walk to hand out
+
+	int temp_index;
+	for(temp_index = 0; temp_index < BATCH_SIZE; temp_index ++) {
+		if(fpp_next < nb_walks) {
+			batch_rips[temp_index] = &&fpp_start;
+			fpp_in[temp_index] = fpp_next ++;
+		} else {
+			batch_rips[temp_index] = &&fpp_end;
+			iMask = FPP_SET(iMask, temp_index);
+		}
+	}
+
+fpp_start:
+
+        cur_node[I] = fpp_in[I];
+        
+        for(i[I] = 0; i[I] < STEPS; i[I] ++) {
+            FPP_PSS(&graph.offsets[cur_node[I]], fpp_label_1);
+fpp_label_1:
+
+            sum += cur_node[I];
+            
+            /** < Compute the next neighbor */
+            nbh_lo[I] = graph.offsets[cur_node[I]];
+            degree[I] = graph.offsets[cur_node[I] + 1] - nbh_lo[I];
+            nbh[I] = nbh_lo[I] + rand_walk_rng(fpp_in[I], i[I]) % degree[I];
+            
+            FPP_PSS(&graph.adj[nbh[I]], fpp_label_2);
+fpp_label_2:
+
+            cur_node[I] = graph.adj[nbh[I]];
+        }
+        
+fpp_end:
+    if(fpp_next < nb_walks) {
+        fpp_in[I] = fpp_next ++;
+        goto fpp_start;
+    }
+    batch_rips[I] = &&fpp_end;
+    iMask = FPP_SET(iMask, I); 
+    if(iMask == (1 << BATCH_SIZE) - 1) {
+        return;
+    }
+    I = (I + 1) & BATCH_SIZE_;
+    goto *batch_rips[I];
+
+}
+
+int main(int argc, char **argv)
+{
+	/** < Variables for PAPI */
+	float real_time, proc_time, ipc;
+	long long ins;
+	int retval;
+
+	red_printf("main: Initializing nodes for random walk\n");
+	rand_walk_init(&graph);
+
+	red_printf("main: Starting random walks\n");
+	/** < Init PAPI_TOT_INS and PAPI_TOT_CYC counters */
+	if((retval = PAPI_ipc(&real_time, &proc_time, &ins, &ipc)) < PAPI_OK) {    
+		printf("PAPI error: retval: %d\n", retval);
+		exit(1);
+	}
+
+	/** < Do a random-walk from every node in the graph. Slots are refilled,
+	  * so all walks go into one call. */
+	process_walks_refill(NUM_NODES);
+
+	if((retval = PAPI_ipc(&real_time, &proc_time, &ins, &ipc)) < PAPI_OK) {    
+		printf("PAPI error: retval: %d\n", retval);
+		exit(1);
+	}
+
+	red_printf("Time = %.4f, rate = %.2f sum = %lld\n"
+		"Instructions = %lld, IPC = %f\n",
+		real_time, NUM_NODES / real_time, sum,
+		ins, ipc);
+
+	return 0;
+}
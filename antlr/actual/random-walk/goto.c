@@ -7,17 +7,21 @@
 #include "fpp.h"
 #include "rand-walk.h"
 
-struct node *nodes;
+struct rand_walk_graph graph;
 
 long long sum = 0;
 
 // batch_index must be declared outside process_batch
 int batch_index = 0;
-void process_batch(struct node *nodes)
+
+/** < Walk w starts at node w */
+void process_batch(int walk_lo)
 {
-	int next_nbh[BATCH_SIZE];
+	int cur_node[BATCH_SIZE];
+	int degree[BATCH_SIZE];
+	int nbh_lo[BATCH_SIZE];
 	int i[BATCH_SIZE];
-	struct node *cur_node[BATCH_SIZE];
+	int nbh[BATCH_SIZE];
 
 	int I = 0;			// batch index
 	void *batch_rips[BATCH_SIZE];		// goto targets
@@ -30,21 +34,23 @@ void process_batch(struct node *nodes)
 
 fpp_start:
 
-        cur_node[I] = &nodes[I];
+        cur_node[I] = walk_lo + I;
         
         for(i[I] = 0; i[I] < STEPS; i[I] ++) {
-            FPP_PSS(cur_node[I], fpp_label_1);
+            FPP_PSS(&graph.offsets[cur_node[I]], fpp_label_1);
 fpp_label_1:
 
-            sum += cur_node[I]->id;
+            sum += cur_node[I];
             
             /** < Compute the next neighbor */
-            next_nbh[I] = -1;
-            while(next_nbh[I] < 0) {
-                next_nbh[I] = rand() % 7;
-            }
+            nbh_lo[I] = graph.offsets[cur_node[I]];
+            degree[I] = graph.offsets[cur_node[I] + 1] - nbh_lo[I];
+            nbh[I] = nbh_lo[I] + rand_walk_rng(walk_lo + I, i[I]) % degree[I];
             
-            cur_node[I] = (struct node *) nodes[I].neighbors[next_nbh[I]];
+            FPP_PSS(&graph.adj[nbh[I]], fpp_label_2);
+fpp_label_2:
+
+            cur_node[I] = graph.adj[nbh[I]];
         }
         
 fpp_end:
@@ -68,7 +74,7 @@ int main(int argc, char **argv)
 	int retval;
 
 	red_printf("main: Initializing nodes for random walk\n");
-	rand_walk_init(&nodes);
+	rand_walk_init(&graph);
 
 	red_printf("main: Starting random walks\n");
 	/** < Init PAPI_TOT_INS and PAPI_TOT_CYC counters */
@@ -79,7 +85,7 @@ int main(int argc, char **argv)
 
 	/** < Do a random-walk from every node in the graph */
 	for(i = 0; i < NUM_NODES; i += BATCH_SIZE) {
-		process_batch(&nodes[i]);
+		process_batch(i);
 	}
 
 	if((retval = PAPI_ipc(&real_time, &proc_time, &ins, &ipc)) < PAPI_OK) {    
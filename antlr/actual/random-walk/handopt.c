@@ -8,38 +8,43 @@
 #include "fpp.h"
 #include "rand-walk.h"
 
-struct node *nodes;
+struct rand_walk_graph graph;
 
 long long sum = 0;
 
 // batch_index must be declared outside process_batch
 int batch_index = 0;
 
-void process_batch(struct node *nodes) 
+/** < Walk w starts at node w */
+void process_batch(int walk_lo) 
 {
-	int i, batch_index, next_nbh;
-	struct node *cur_node[BATCH_SIZE];
+	int i, batch_index, nbh_lo, degree;
+	int cur_node[BATCH_SIZE], nbh[BATCH_SIZE];
 		
 	for(batch_index = 0; batch_index < BATCH_SIZE; batch_index ++) {
-		cur_node[batch_index] = &nodes[batch_index];
+		cur_node[batch_index] = walk_lo + batch_index;
+		__builtin_prefetch(&graph.offsets[cur_node[batch_index]], 0, 0);
 	}
 
 	for(i = 0; i < STEPS; i ++) {
+		/** < Pick the next neighbor, and prefetch its adjacency slot */
 		for(batch_index = 0; batch_index < BATCH_SIZE; batch_index ++) {
-			sum += cur_node[batch_index]->id;
+			sum += cur_node[batch_index];
 
-			/** < Compute the next neighbor */
-			next_nbh = -1;
-			while(next_nbh < 0) {
-				next_nbh = rand() % 7;
-			}
-		
-			cur_node[batch_index] = 
-				(struct node *) nodes[batch_index].neighbors[next_nbh];
-			__builtin_prefetch(cur_node[batch_index], 0, 0);
+			nbh_lo = graph.offsets[cur_node[batch_index]];
+			degree = graph.offsets[cur_node[batch_index] + 1] - nbh_lo;
+			nbh[batch_index] = nbh_lo +
+				rand_walk_rng(walk_lo + batch_index, i) % degree;
+
+			__builtin_prefetch(&graph.adj[nbh[batch_index]], 0, 0);
+		}
+
+		/** < Move to the neighbor, and prefetch its offsets */
+		for(batch_index = 0; batch_index < BATCH_SIZE; batch_index ++) {
+			cur_node[batch_index] = graph.adj[nbh[batch_index]];
+			__builtin_prefetch(&graph.offsets[cur_node[batch_index]], 0, 0);
 		}
 	}
-		
 }
 
 int main(int argc, char **argv)
@@ -52,7 +57,7 @@ int main(int argc, char **argv)
 	int retval;
 
 	red_printf("main: Initializing nodes for random walk\n");
-	rand_walk_init(&nodes);
+	rand_walk_init(&graph);
 
 	red_printf("main: Starting random walks\n");
 	/** < Init PAPI_TOT_INS and PAPI_TOT_CYC counters */
@@ -63,7 +68,7 @@ int main(int argc, char **argv)
 
 	/** < Do a random-walk from every node in the graph */
 	for(i = 0; i < NUM_NODES; i += BATCH_SIZE) {
-		process_batch(&nodes[i]);
+		process_batch(i);
 	}
 
 	if((retval = PAPI_ipc(&real_time, &proc_time, &ins, &ipc)) < PAPI_OK) {    
@@ -8,32 +8,32 @@
 #include "fpp.h"
 #include "rand-walk.h"
 
-struct node *nodes;
+struct rand_walk_graph graph;
 
 long long sum = 0;
 
 // batch_index must be declared outside process_batch
 int batch_index = 0;
 
-void process_batch(struct node *nodes) 
+/** < Walk w starts at node w */
+void process_batch(int walk_lo) 
 {
 	foreach(batch_index, BATCH_SIZE) {
-		int i, next_nbh;
-		struct node *cur_node = &nodes[batch_index];
+		int i, nbh_lo, degree, nbh;
+		int cur_node = walk_lo + batch_index;
 
 		for(i = 0; i < STEPS; i ++) {
-			FPP_EXPENSIVE(cur_node);
-			sum += cur_node->id;
+			FPP_EXPENSIVE(&graph.offsets[cur_node]);
+			sum += cur_node;
 
 			/** < Compute the next neighbor */
-			next_nbh = -1;
-			while(next_nbh < 0) {
-				next_nbh = rand() % 7;
-			}
-		
-			cur_node = (struct node *) nodes[batch_index].neighbors[next_nbh];
+			nbh_lo = graph.offsets[cur_node];
+			degree = graph.offsets[cur_node + 1] - nbh_lo;
+			nbh = nbh_lo + rand_walk_rng(walk_lo + batch_index, i) % degree;
+
+			FPP_EXPENSIVE(&graph.adj[nbh]);
+			cur_node = graph.adj[nbh];
 		}
-		
 	}
 }
 
@@ -47,7 +47,7 @@ int main(int argc, char **argv)
 	int retval;
 
 	red_printf("main: Initializing nodes for random walk\n");
-	rand_walk_init(&nodes);
+	rand_walk_init(&graph);
 
 	red_printf("main: Starting random walks\n");
 	/** < Init PAPI_TOT_INS and PAPI_TOT_CYC counters */
@@ -58,7 +58,7 @@ int main(int argc, char **argv)
 
 	/** < Do a random-walk from every node in the graph */
 	for(i = 0; i < NUM_NODES; i += BATCH_SIZE) {
-		process_batch(&nodes[i]);
+		process_batch(i);
 	}
 
 	if((retval = PAPI_ipc(&real_time, &proc_time, &ins, &ipc)) < PAPI_OK) {    
@@ -1,38 +1,61 @@
 #include "rand-walk.h"
 
-void rand_walk_init(struct node **nodes)
+/** < Allocate bytes in hugepages with shmget */
+static void *rand_walk_shm_alloc(int key, long long bytes)
 {
-	int i, j;
-
-	/** < Allocate the nodes */
-	printf("\tInitializing nodes for random walk. Size = %lu bytes\n", 
-		NUM_NODES * sizeof(struct node));
-
-	int sid = shmget(RAND_WALK_KEY, NUM_NODES * sizeof(struct node), 
-		IPC_CREAT | 0666 | SHM_HUGETLB);
+	/** < A segment left over by an earlier run may be smaller than bytes */
+	int sid = shmget(key, 0, 0);
+	if(sid >= 0) {
+		shmctl(sid, IPC_RMID, NULL);
+	}
 
+	sid = shmget(key, bytes, IPC_CREAT | 0666 | SHM_HUGETLB);
 	if(sid < 0) {
-		printf("\tCould not create nodes for random walk\n");
+		printf("\tCould not create graph for random walk\n");
 		exit(-1);
 	}
 
-	*nodes = shmat(sid, 0, 0);
-	memset((char *) *nodes, 0, NUM_NODES * sizeof(struct node));
+	void *buf = shmat(sid, 0, 0);
+	assert(buf != (void *) -1);
+
+	/** < Removed once we detach, so that the next run gets a fresh one */
+	shmctl(sid, IPC_RMID, NULL);
+	return buf;
+}
+
+void rand_walk_init(struct rand_walk_graph *graph)
+{
+	int i, j;
+	uint64_t seed = 0xdeadbeef;
 
-	/** < Initialize nodes with random pointers */
-	printf("\tInitializing all nodes\n");
+	graph->num_nodes = NUM_NODES;
+	graph->offsets = rand_walk_shm_alloc(RAND_WALK_OFFSETS_KEY,
+		(NUM_NODES + 1) * sizeof(int));
 
+	/** < Pick the degrees first so that adj can be sized exactly */
+	printf("\tInitializing node degrees\n");
+	graph->offsets[0] = 0;
 	for(i = 0; i < NUM_NODES; i++) {
-		(*nodes)[i].id = i;
-		for(j = 0; j < 7; j ++) {
-			/** < Compute a random neighbor */
-			int nbh_id = rand() & NUM_NODES_;
-			(*nodes)[i].neighbors[j] = (void *) &((*nodes)[nbh_id]);
-		}	
+		seed = seed * 1103515245 + 12345;
+		int degree = 1 + (int) ((seed >> 32) % (2 * AVG_DEGREE - 1));
+		graph->offsets[i + 1] = graph->offsets[i] + degree;
 	}
 
-}
+	graph->num_edges = graph->offsets[NUM_NODES];
+	printf("\tInitializing %d edges for random walk. Size = %lu bytes\n",
+		graph->num_edges, (NUM_NODES + 1 + graph->num_edges) * sizeof(int));
+
+	graph->adj = rand_walk_shm_alloc(RAND_WALK_ADJ_KEY,
+		(long long) graph->num_edges * sizeof(int));
 
+	/** < Initialize nodes with random neighbors */
+	for(i = 0; i < NUM_NODES; i++) {
+		for(j = graph->offsets[i]; j < graph->offsets[i + 1]; j ++) {
+			seed = seed * 1103515245 + 12345;
+			graph->adj[j] = (seed >> 32) & NUM_NODES_;
+		}
+	}
+}
 
 void red_printf(const char *format, ...)
 {	
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stdint.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <assert.h>
@@ -14,18 +15,36 @@
 //#define NUM_NODES (256 * 1024)
 //#define NUM_NODES_ (NUM_NODES - 1)
 
-/** < Key for shmget */
-#define RAND_WALK_KEY 1
+/** < Node degrees are uniform in [1, 2 * AVG_DEGREE - 1] */
+#define AVG_DEGREE 7
+
+/** < Keys for shmget */
+#define RAND_WALK_OFFSETS_KEY 1
+#define RAND_WALK_ADJ_KEY 2
 
 /** < Number of random-walk steps */
 #define STEPS 10
 
-struct node
+/** < Graph in CSR layout: the neighbors of node v are
+  *  adj[offsets[v] ... offsets[v + 1] - 1] */
+struct rand_walk_graph
 {
-	long long id;
-	void *neighbors[7];
+	int num_nodes;
+	int num_edges;
+	int *offsets;		/** < num_nodes + 1 entries */
+	int *adj;
 };
 
-void rand_walk_init(struct node **nodes);
+void rand_walk_init(struct rand_walk_graph *graph);
 void red_printf(const char *format, ...);
 
+/** < Counter-based RNG (splitmix64 finalizer). The random number for a step
+  *  depends only on the walk and the step number, so every variant takes
+  *  the same walks regardless of how they are interleaved. */
+static inline uint64_t rand_walk_rng(uint64_t walk_id, int step)
+{
+	uint64_t z = (walk_id * STEPS + step + 1) * 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
@@ -19,3 +19,8 @@ blue ""
 blue "Running handopt"
 shm-rm.sh 1>/dev/null 2>/dev/null
 sudo taskset -c 0 ./handopt
+
+blue ""
+blue "Running goto-refill"
+shm-rm.sh 1>/dev/null 2>/dev/null
+sudo taskset -c 0 ./goto-refill
@@ -0,0 +1,29 @@
+#include<string.h>
+#include<assert.h>
+
+/** < Counting sort of pkts by PKT_DEPTH. Packets with the same predicted
+  * depth become adjacent, so a batch finishes at about the same time. */
+static void bin_by_depth(int *pkts, int n)
+{
+	int i, d;
+	int bin_start[DEPTH + 2];
+
+	int *binned = (int *) malloc(n * sizeof(int));
+	assert(binned != NULL);
+
+	memset(bin_start, 0, sizeof(bin_start));
+	for(i = 0; i < n; i ++) {
+		bin_start[PKT_DEPTH(pkts[i]) + 1] ++;
+	}
+
+	for(d = 1; d <= DEPTH + 1; d ++) {
+		bin_start[d] += bin_start[d - 1];
+	}
+
+	for(i = 0; i < n; i ++) {
+		binned[bin_start[PKT_DEPTH(pkts[i])] ++] = pkts[i];
+	}
+
+	memcpy(pkts, binned, n * sizeof(int));
+	free(binned);
+}
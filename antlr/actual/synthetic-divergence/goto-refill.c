@@ -0,0 +1,154 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<pthread.h>
+#include<time.h>
+#include<sys/ipc.h>
+#include<sys/shm.h>
+
+#include "param.h"
+#include "fpp.h"
+#include "bin.h"
+
+struct cache_bkt		/* 64 bytes */
+{
+	int slot_arr[SLOTS_PER_BKT];
+};
+struct cache_bkt *cache;
+
+#define ABS(a) (a > 0 ? a : -1 * a)
+
+// Each packet contains a random integer. The memory address accessed
+// by the packet is determined by an expensive hash of the integer.
+int *pkts;
+
+int sum = 0;
+
+// batch_index must be declared outside process_pkts_in_batch
+int batch_index = 0;
+
+// Process nb_pkts pkts starting from lo, refilling slots as lookups end
+void process_pkts_refill(int *pkt_lo, int nb_pkts)
+{
+	int i[BATCH_SIZE];
+	int jumper[BATCH_SIZE];
+	int *arr[BATCH_SIZE];
+	int best_j[BATCH_SIZE];
+	int j[BATCH_SIZE];
+	int max_diff[BATCH_SIZE];
+	int depth[BATCH_SIZE];
+
+	int I = 0;			// batch index
+	void *batch_rips[BATCH_SIZE];		// goto targets
+	int iMask = 0;		// No slot is done yet
+
+	// Slot I works on input fpp_in[I]. A slot that finishes takes the next
+	// input, so lookups that end early do not leave it idle.
+	int fpp_in[BATCH_SIZE];
+	int fpp_next = 0;		// Next input to hand out
+
+	int temp_index;
+	for(temp_index = 0; temp_index < BATCH_SIZE; temp_index ++) {
+		if(fpp_next < nb_pkts) {
+			batch_rips[temp_index] = &&fpp_start;
+			fpp_in[temp_index] = fpp_next ++;
+		} else {
+			batch_rips[temp_index] = &&fpp_end;
+			iMask = FPP_SET(iMask, temp_index);
+		}
+	}
+
+fpp_start:
+
+    // Like a foreach loop
+    
+        jumper[I] = pkt_lo[fpp_in[I]];
+        depth[I] = PKT_DEPTH(jumper[I]);
+        
+        for(i[I] = 0; i[I] < depth[I]; i[I]++) {
+            FPP_PSS(&cache[jumper[I]], fpp_label_1);
+fpp_label_1:
+
+            arr[I] = cache[jumper[I]].slot_arr;
+            best_j[I] = 0;
+            
+            max_diff[I] = ABS(arr[I][0] - jumper[I]) % 8;
+            
+            for(j[I] = 1; j[I] < SLOTS_PER_BKT; j[I] ++) {
+                if(ABS(arr[I][j[I]] - jumper[I]) % 8 > max_diff[I]) {
+                    max_diff[I] = ABS(arr[I][j[I]] - jumper[I]) % 8;
+                    best_j[I] = j[I];
+                }
+            }
+            
+            jumper[I] = arr[I][best_j[I]];
+            if(jumper[I] % 16 == 0) {      // GCC will optimize this
+                break;
+            }
+        }
+        
+        sum += jumper[I];
+       
+fpp_end:
+    if(fpp_next < nb_pkts) {
+        fpp_in[I] = fpp_next ++;
+        goto fpp_start;
+    }
+    batch_rips[I] = &&fpp_end;
+    iMask = FPP_SET(iMask, I); 
+    if(iMask == (1 << BATCH_SIZE) - 1) {
+        return;
+    }
+    I = (I + 1) & BATCH_SIZE_;
+    goto *batch_rips[I];
+
+}
+
+int main(int argc, char **argv)
+{
+	int i, j;
+
+	// Allocate a large memory area
+	fprintf(stderr, "Size of cache = %lu\n", NUM_BS * sizeof(struct cache_bkt));
+
+	int sid = shmget(CACHE_SID, NUM_BS * sizeof(struct cache_bkt), 
+		IPC_CREAT | 0666 | SHM_HUGETLB);
+	if(sid < 0) {
+		fprintf(stderr, "Could not create cache\n");
+		exit(-1);
+	}
+	cache = shmat(sid, 0, 0);
+
+	// Fill in the cache with index into itself
+	for(i = 0; i < NUM_BS; i ++) {
+		for(j = 0; j < SLOTS_PER_BKT; j++) {
+			cache[i].slot_arr[j] = rand() & NUM_BS_;
+		}
+	}
+
+	// Allocate the packets
+	pkts = (int *) malloc(NUM_PKTS * sizeof(int));
+	for(i = 0; i < NUM_PKTS; i++) {
+		pkts[i] = rand() & NUM_BS_;
+	}
+
+	if(BIN_BY_DEPTH) {
+		bin_by_depth(pkts, NUM_PKTS);
+	}
+
+	fprintf(stderr, "Finished creating cache and packets\n");
+
+	long long start, end;
+	start = get_cycles();
+
+	// Slots are refilled, so all packets go into one call
+	process_pkts_refill(pkts, NUM_PKTS);
+	
+	end = get_cycles();
+
+	// xia-router2 frequency = 2.7 Ghz
+	long long ns = ((long long) (end - start) / 2.7);
+
+	printf("Total time = %f s, sum = %d\n", ns / 1000000000.0, sum);
+	printf("Average time per packet = %lld ns \n", ns / NUM_PKTS);
+
+}
@@ -7,6 +7,7 @@
 
 #include "param.h"
 #include "fpp.h"
+#include "bin.h"
 
 struct cache_bkt		/* 64 bytes */
 {
@@ -34,6 +35,7 @@ int process_pkts_in_batch(int *pkt_lo)
 	int best_j[BATCH_SIZE];
 	int j[BATCH_SIZE];
 	int max_diff[BATCH_SIZE];
+	int depth[BATCH_SIZE];
 
 	int I = 0;			// batch index
 	void *batch_rips[BATCH_SIZE];		// goto targets
@@ -49,8 +51,9 @@ fpp_start:
     // Like a foreach loop
     
         jumper[I] = pkt_lo[I];
+        depth[I] = PKT_DEPTH(jumper[I]);
         
-        for(i[I] = 0; i[I] < DEPTH; i[I]++) {
+        for(i[I] = 0; i[I] < depth[I]; i[I]++) {
             FPP_PSS(&cache[jumper[I]], fpp_label_1);
 fpp_label_1:
 
@@ -113,6 +116,10 @@ int main(int argc, char **argv)
 		pkts[i] = rand() & NUM_BS_;
 	}
 
+	if(BIN_BY_DEPTH) {
+		bin_by_depth(pkts, NUM_PKTS);
+	}
+
 	fprintf(stderr, "Finished creating cache and packets\n");
 
 	long long start, end;
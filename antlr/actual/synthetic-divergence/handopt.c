@@ -7,6 +7,7 @@
 
 #include "fpp.h"
 #include "param.h"
+#include "bin.h"
 
 #define foreach(i, n) for(i = 0; i < n; i ++)
 
@@ -30,18 +31,19 @@ int batch_index = 0;
 // Process BATCH_SIZE pkts starting from lo
 int process_pkts_in_batch(int *pkt_lo)
 {
-	int jumper[BATCH_SIZE];
+	int jumper[BATCH_SIZE], depth[BATCH_SIZE];
 	int iMask = 0, b_i;			// Completion mask and batch index
 
 	// Phase 1: initialize jumper and issue 1st prefetech
 	for(b_i = 0; b_i < BATCH_SIZE; b_i ++) {
 		jumper[b_i] = pkt_lo[b_i];
+		depth[b_i] = PKT_DEPTH(jumper[b_i]);
 		__builtin_prefetch(&cache[jumper[b_i]], 0, 0);
 	}
 
 	// Phase 2: Jump around a bit
 	int i;
-	for(i = 0; i < DEPTH; i++) {
+	for(i = 0; i < DEPTH && iMask != (1 << BATCH_SIZE) - 1; i++) {
 		for(b_i = 0; b_i < BATCH_SIZE; b_i ++) {
 			if(FPP_ISSET(iMask, b_i)) {
 				continue;
@@ -59,9 +61,9 @@ int process_pkts_in_batch(int *pkt_lo)
 			}
 
 			jumper[b_i] = arr[best_j];
-			if(jumper[b_i] % 16 == 0) {
+			if(jumper[b_i] % 16 == 0 || i == depth[b_i] - 1) {
 				iMask = FPP_SET(iMask, b_i);
-			} else if (i != DEPTH - 1) {
+			} else {
 				__builtin_prefetch(&cache[jumper[b_i]], 0, 0);
 			}
 		}
@@ -102,6 +104,10 @@ int main(int argc, char **argv)
 		pkts[i] = rand() & NUM_BS_;
 	}
 
+	if(BIN_BY_DEPTH) {
+		bin_by_depth(pkts, NUM_PKTS);
+	}
+
 	fprintf(stderr, "Finished creating cache and packets\n");
 
 	long long start, end;
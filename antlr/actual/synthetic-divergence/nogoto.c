@@ -7,6 +7,7 @@
 
 #include "param.h"
 #include "fpp.h"
+#include "bin.h"
 
 struct cache_bkt		/* 64 bytes */
 {
@@ -33,8 +34,9 @@ int process_pkts_in_batch(int *pkt_lo)
 		
 		int i;
 		int jumper = pkt_lo[batch_index];
+		int depth = PKT_DEPTH(jumper);
 			
-		for(i = 0; i < DEPTH; i++) {
+		for(i = 0; i < depth; i++) {
 			FPP_EXPENSIVE(&cache[jumper]);
 			int *arr = cache[jumper].slot_arr;
 			int j, best_j = 0;
@@ -86,6 +88,10 @@ int main(int argc, char **argv)
 		pkts[i] = rand() & NUM_BS_;
 	}
 
+	if(BIN_BY_DEPTH) {
+		bin_by_depth(pkts, NUM_PKTS);
+	}
+
 	fprintf(stderr, "Finished creating cache and packets\n");
 
 	long long start, end;
@@ -1,6 +1,22 @@
 #define SLOTS_PER_BKT 16
 
+/** < Lookups take at most DEPTH steps. PKT_DEPTH is a cheap prediction
+  * of a packet's depth (like a prefix length or a name's component count);
+  * the lookup can still end earlier. By default every packet has depth
+  * DEPTH, which is the original workload. With VAR_DEPTH, depths are spread
+  * over 1 ... DEPTH, so about half the packets do less work in every
+  * variant: numbers are not comparable with VAR_DEPTH 0 runs. */
 #define DEPTH 2
+#define VAR_DEPTH 0
+#if VAR_DEPTH == 1
+#define PKT_DEPTH(pkt) (1 + (((pkt) >> 4) % DEPTH))
+#else
+#define PKT_DEPTH(pkt) DEPTH
+#endif
+
+/** < Reorder the packets by PKT_DEPTH before processing them, so that the
+  * lookups in a batch take similar paths. Only useful with VAR_DEPTH. */
+#define BIN_BY_DEPTH 0
 #define NUM_PKTS (16 * 1024 * 1024)
 
 #define CACHE_SID 1
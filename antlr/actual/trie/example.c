@@ -2,9 +2,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <assert.h>
 #include <papi.h>
 
 #include "trie.h"
+#include "fpp.h"
 
 #define NUM_WORDS 235885
 #define MAX_WORD_LEN 26		// Max word length in dictionary
@@ -19,9 +21,13 @@ inline uint32_t fastrand(uint64_t* seed)
 
 int main(int argc, char **argv) 
 {
-	int i, retval;
+	int i, j, retval;
 	uint64_t seed = 0xdeadbeef;
 
+	// Use interleaved lookups with trie_exists_bulk()?
+	assert(argc == 2);
+	int use_bulk = atoi(argv[1]);
+
 	// Variables for PAPI
 	float real_time, proc_time, ipc;
 	long long ins;
@@ -49,9 +55,25 @@ int main(int argc, char **argv)
 
 	// Do some lookups
 	int num_exists = 0;
-	for(i = 0; i < NUM_LOOKUPS; i ++) {
-		int index = fastrand(&seed) & 131071;
-		num_exists += trie_exists(t, words[index]);
+	if(use_bulk == 0) {
+		for(i = 0; i < NUM_LOOKUPS; i ++) {
+			int index = fastrand(&seed) & 131071;
+			num_exists += trie_exists(t, words[index]);
+		}
+	} else {
+		char *batch_words[BATCH_SIZE];
+		int batch_exists[BATCH_SIZE];
+
+		for(i = 0; i < NUM_LOOKUPS; i += BATCH_SIZE) {
+			for(j = 0; j < BATCH_SIZE; j ++) {
+				batch_words[j] = words[fastrand(&seed) & 131071];
+			}
+
+			trie_exists_bulk(t, batch_words, batch_exists, BATCH_SIZE);
+			for(j = 0; j < BATCH_SIZE; j ++) {
+				num_exists += batch_exists[j];
+			}
+		}
 	}
 
 	if((retval = PAPI_ipc(&real_time, &proc_time, &ins, &ipc)) < PAPI_OK) {    
@@ -1 +1,5 @@
-./example < words.txt
+echo "Running serial lookups"
+./example 0 < words.txt
+
+echo "Running trie_exists_bulk lookups"
+./example 1 < words.txt
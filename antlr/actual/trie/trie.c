@@ -5,46 +5,305 @@
 #include <assert.h>
 
 #include "trie.h"
+#include "fpp.h"
 
-inline trie_t *trie_init(void) 
+/**< Free cells are kept on a circular, doubly-linked list that is threaded
+  *  through the cells themselves: a free cell stores -(next + 1) in check and
+  *  -(prev + 1) in base. A negative check never matches a state. */
+#define TRIE_IS_FREE(t, i) ((t)->cells[i].check < 0)
+#define TRIE_NEXT_FREE(t, i) (-(t)->cells[i].check - 1)
+#define TRIE_PREV_FREE(t, i) (-(t)->cells[i].base - 1)
+#define TRIE_SET_NEXT_FREE(t, i, n) ((t)->cells[i].check = -(n) - 1)
+#define TRIE_SET_PREV_FREE(t, i, p) ((t)->cells[i].base = -(p) - 1)
+
+/**< Number of free cells tried from the head of the list before rotating */
+#define TRIE_MAX_TRIES 16
+
+/**< Add cell i to the tail of the free list */
+static void trie_put_free(trie_t *t, int i)
+{
+	if(t->free_head == -1) {
+		t->free_head = i;
+		TRIE_SET_NEXT_FREE(t, i, i);
+		TRIE_SET_PREV_FREE(t, i, i);
+		return;
+	}
+
+	int head = t->free_head;
+	int tail = TRIE_PREV_FREE(t, head);
+
+	TRIE_SET_NEXT_FREE(t, i, head);
+	TRIE_SET_PREV_FREE(t, i, tail);
+	TRIE_SET_NEXT_FREE(t, tail, i);
+	TRIE_SET_PREV_FREE(t, head, i);
+}
+
+/**< Remove free cell i from the free list and make it a childless state
+  *  with parent s */
+static void trie_take_free(trie_t *t, int i, int s)
+{
+	assert(TRIE_IS_FREE(t, i));
+
+	int next = TRIE_NEXT_FREE(t, i);
+	int prev = TRIE_PREV_FREE(t, i);
+
+	if(next == i) {
+		t->free_head = -1;
+	} else {
+		TRIE_SET_NEXT_FREE(t, prev, next);
+		TRIE_SET_PREV_FREE(t, next, prev);
+		if(t->free_head == i) {
+			t->free_head = next;
+		}
+	}
+
+	t->cells[i].base = 0;
+	t->cells[i].check = s;
+}
+
+/**< Double the arena until it has at least min_cells cells */
+static void trie_grow(trie_t *t, int min_cells)
+{
+	int i, new_num_cells = t->num_cells;
+	while(new_num_cells < min_cells) {
+		new_num_cells *= 2;
+	}
+
+	if(new_num_cells == t->num_cells) {
+		return;
+	}
+
+	/**< The cells are the arena's only allocation, so they grow in place
+	  *  or move to a new chunk that replaces the old one */
+	t->cells = arena_realloc(&t->arena, t->cells,
+		t->num_cells * sizeof(struct trie_cell),
+		new_num_cells * sizeof(struct trie_cell));
+
+	for(i = t->num_cells; i < new_num_cells; i ++) {
+		trie_put_free(t, i);
+	}
+
+	t->num_cells = new_num_cells;
+}
+
+trie_t *trie_init(void) 
+{
+	trie_t *t = malloc(sizeof(trie_t));
+	assert(t != NULL);
+
+	arena_init(&t->arena, TRIE_SOCKET_ID);
+	t->cells = arena_alloc(&t->arena,
+		TRIE_INIT_CELLS * sizeof(struct trie_cell));
+	t->num_cells = TRIE_INIT_CELLS;
+	t->free_head = -1;
+
+	/**< The root is its own parent so that it is never handed out. A non-zero
+	  *  base keeps the empty word from matching the root itself. */
+	t->cells[TRIE_ROOT].base = 1;
+	t->cells[TRIE_ROOT].check = TRIE_ROOT;
+
+	int i;
+	for(i = TRIE_ROOT + 1; i < t->num_cells; i ++) {
+		trie_put_free(t, i);
+	}
+
+	return t;
+}
+
+/**< Find a base >= 1 such that base + kids[i] is free for all i. kids[] is
+  *  sorted in increasing order. Only bases that put kids[0] on a free cell
+  *  are tried. The arena is grown so that base + c is a valid index for
+  *  every character c, so lookups never need a bounds check. */
+static int trie_find_base(trie_t *t, int *kids, int num_kids)
+{
+	int i, base, f = t->free_head, first = t->free_head, num_tries = 0;
+
+	while(f != -1) {
+		/**< Cells near the head of the list that keep failing are in dense
+		  *  regions. Rotate them to the tail so later searches skip them. */
+		if(++ num_tries > TRIE_MAX_TRIES) {
+			t->free_head = f;
+			num_tries = 0;
+		}
+
+		base = f - kids[0];
+
+		if(base >= 1) {
+			trie_grow(t, base + TRIE_SIZE + 1);
+
+			for(i = 1; i < num_kids; i ++) {
+				if(!TRIE_IS_FREE(t, base + kids[i])) {
+					break;
+				}
+			}
+
+			if(i == num_kids) {
+				return base;
+			}
+		}
+
+		f = TRIE_NEXT_FREE(t, f);
+		if(f == first) {
+			break;
+		}
+	}
+
+	/**< No fit among the free cells: use fresh cells past the end */
+	base = t->num_cells - kids[0];
+	if(base < 1) {
+		base = 1;
+	}
+
+	trie_grow(t, base + TRIE_SIZE + 1);
+	return base;
+}
+
+/**< Move the children of state s to a new base that also has room for a
+  *  child on character c. */
+static void trie_relocate(trie_t *t, int s, int c)
 {
-    return malloc(sizeof(trie_t));
+	int kids[TRIE_SIZE], num_kids = 0;
+	int k, d, old_base = t->cells[s].base;
+
+	for(k = 0; k < TRIE_SIZE; k ++) {
+		if(k == c || (old_base > 0 &&
+			t->cells[old_base + k].check == s)) {
+			kids[num_kids ++] = k;
+		}
+	}
+
+	int new_base = trie_find_base(t, kids, num_kids);
+
+	for(k = 0; k < num_kids; k ++) {
+		if(kids[k] == c) {
+			continue;
+		}
+
+		int old = old_base + kids[k];
+		int new = new_base + kids[k];
+		int kid_base = t->cells[old].base;
+
+		trie_take_free(t, new, s);
+		t->cells[new].base = kid_base;
+
+		/**< Grandchildren must now point to the moved child */
+		if(kid_base > 0) {
+			for(d = 0; d < TRIE_SIZE; d ++) {
+				if(t->cells[kid_base + d].check == old) {
+					t->cells[kid_base + d].check = new;
+				}
+			}
+		}
+
+		trie_put_free(t, old);
+	}
+
+	t->cells[s].base = new_base;
 }
 
 void trie_add(trie_t *t, char *word) 
 {
-	int c;
-	while ((c = *word++)) {
+	int c, s = TRIE_ROOT;
+
+	/**< The terminator is inserted as a transition on '\0' */
+	do {
+		c = (unsigned char) *word;
 		assert(c >= 0 && c < TRIE_SIZE);
-		if (t->chars[c] == NULL) {
-			t->chars[c] = trie_init();
+
+		int next = t->cells[s].base + c;
+		if(t->cells[s].base == 0 || t->cells[next].check != s) {
+			if(t->cells[s].base == 0 || !TRIE_IS_FREE(t, next)) {
+				trie_relocate(t, s, c);
+				next = t->cells[s].base + c;
+			}
+
+			trie_take_free(t, next, s);
 		}
-		t = t->chars[c];
-	}
-	t->sentinel = (void*) !NULL;
+
+		s = next;
+	} while(*word++ != 0);
 }
 
 int trie_exists(trie_t *t, char *word) 
 {
-    int c;
-    while ((c = *word++)) {
-        if (t->chars[c] == NULL) {
-            return 0;
-        }
-        t = t->chars[c];
-    }
-    return t->sentinel != NULL ? 1 : 0;
+	int c, s = TRIE_ROOT;
+	struct trie_cell *cells = t->cells;
+
+	do {
+		c = (unsigned char) *word;
+		if(c >= TRIE_SIZE) {
+			return 0;
+		}
+
+		int next = cells[s].base + c;
+		if(cells[next].check != s) {
+			return 0;
+		}
+
+		s = next;
+	} while(*word++ != 0);
+
+	return 1;
+}
+
+void trie_exists_bulk(trie_t *t, char **words, int *exists, int n)
+{
+	struct trie_cell *cells = t->cells;
+	char *word[BATCH_SIZE];
+	int s[BATCH_SIZE];
+	int c[BATCH_SIZE];
+	int next[BATCH_SIZE];
+
+	int I = 0;			// batch index
+	void *batch_rips[BATCH_SIZE];		// goto targets
+	int iMask = 0;		// No word is done yet
+
+	assert(n > 0 && n <= BATCH_SIZE);
+
+	int temp_index;
+	for(temp_index = 0; temp_index < BATCH_SIZE; temp_index ++) {
+		batch_rips[temp_index] = &&fpp_start;
+	}
+
+fpp_start:
+
+	word[I] = words[I];
+	s[I] = TRIE_ROOT;
+	exists[I] = 0;
+
+	do {
+		c[I] = (unsigned char) *word[I];
+		if(c[I] >= TRIE_SIZE) {
+			goto fpp_end;
+		}
+
+		next[I] = cells[s[I]].base + c[I];
+		FPP_PSS(&cells[next[I]], fpp_label_1, n);
+fpp_label_1:
+
+		if(cells[next[I]].check != s[I]) {
+			goto fpp_end;
+		}
+
+		s[I] = next[I];
+	} while(*word[I]++ != 0);
+
+	exists[I] = 1;
+
+fpp_end:
+	batch_rips[I] = &&fpp_end;
+	iMask = FPP_SET(iMask, I);
+	if(iMask == (1 << n) - 1) {
+		return;
+	}
+	I = (I + 1) < n ? I + 1 : 0;
+	goto *batch_rips[I];
 }
 
 void trie_free(trie_t *t) 
 {
-	int i;
-    for (i = /*skip sentinel*/ 1; i < TRIE_SIZE; i++) {
-        if (t->chars[i] != NULL) {
-            trie_free(t->chars[i]);
-        }
-    }
-    free(t);
+	arena_free_all(&t->arena);
+	free(t);
 }
 
 // Like printf, but red. Limited to 1000 characters.
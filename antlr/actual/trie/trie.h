@@ -1,8 +1,30 @@
+#include <stdint.h>
+#include "arena.h"
+
 #define TRIE_SIZE 128
 
+/**< Initial number of cells in the arena. The arena doubles when full. */
+#define TRIE_INIT_CELLS (64 * 1024)
+
+/**< Socket for the arena that holds the cells */
+#define TRIE_SOCKET_ID 0
+
+/**< A double-array trie. State s has a transition on character c to state
+  *  t = cells[s].base + c iff cells[t].check == s. Words are inserted with
+  *  their '\0' terminator, so a word exists iff its terminator transition
+  *  exists. Free cells have a negative check. */
+#define TRIE_ROOT 0
+
+struct trie_cell {
+	int32_t base;		/**< 0 for states without children */
+	int32_t check;		/**< Parent state, or negative if free */
+};
+
 typedef struct trie_t {
-    void *sentinel;
-    struct trie_t *chars[TRIE_SIZE];
+	struct arena arena;		/**< Backs the cell array */
+	struct trie_cell *cells;	/**< Contiguous array of cells */
+	int num_cells;
+	int free_head;		/**< First free cell, or -1 */
 } trie_t;
 
 void trie_add(trie_t *t, char *word);
@@ -10,4 +32,8 @@ trie_t *trie_init(void);
 int trie_exists(trie_t *, char *);
 void trie_free(trie_t *);
 
+/**< Lookup n <= BATCH_SIZE words with G-Opt interleaving. exists[i] is set
+  *  to 1 if words[i] is in the trie, and 0 otherwise. */
+void trie_exists_bulk(trie_t *t, char **words, int *exists, int n);
+
 void red_printf(const char *format, ...);
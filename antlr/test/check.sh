@@ -0,0 +1,32 @@
+# Checks the committed outputs of the transformer: each test input and each
+# generated benchmark file is transformed again and diffed with the committed
+# file, and test/handopt.sh checks the -handopt output. Run from the antlr
+# dir after building the transformer; exits with 1 if a check fails.
+# test/hand-derived lists the outputs that were written by hand and have not
+# passed this check yet.
+tmp=`mktemp`
+status=0
+
+check() {
+	out=$1
+	shift
+	if ! java Main "$@" $tmp > /dev/null; then
+		echo "FAIL $out: cannot transform"
+		status=1
+	elif ! diff -u $out $tmp; then
+		echo "FAIL $out"
+		status=1
+	else
+		echo "OK $out"
+	fi
+}
+
+for dir in test/*/; do
+	check ${dir}nogoto.c.proc ${dir}nogoto.c
+done
+check actual/locals/goto.c actual/locals/nogoto.c
+check actual/ndn/goto-ctx.c -ctx actual/ndn/nogoto.c
+sh test/handopt.sh || status=1
+
+rm -f $tmp
+exit $status
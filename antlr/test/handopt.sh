@@ -0,0 +1,15 @@
+# Checks -handopt against the hand-written stage-synchronous code of
+# actual/simple: the generated and the hand-written handopt must print the
+# same sum. Run from the antlr dir after building the transformer.
+dir=actual/simple
+java Main -handopt $dir/nogoto.c $dir/gen-handopt.c > /dev/null || exit 1
+gcc -O3 -o $dir/gen-handopt $dir/gen-handopt.c $dir/common.c -lrt -lpapi || exit 1
+gcc -O3 -o $dir/handopt $dir/handopt.c $dir/common.c -lrt -lpapi || exit 1
+
+gen=`(cd $dir && sudo ./gen-handopt 2>/dev/null; shm-rm.sh > /dev/null 2>&1) | grep -o "sum = -*[0-9]*"`
+hand=`(cd $dir && sudo ./handopt 2>/dev/null; shm-rm.sh > /dev/null 2>&1) | grep -o "sum = -*[0-9]*"`
+if [ -z "$gen" ] || [ "$gen" != "$hand" ]; then
+	echo "handopt mismatch: generated \"$gen\", hand-written \"$hand\""
+	exit 1
+fi
+echo "handopt OK: $gen"
@@ -0,0 +1,42 @@
+void process_batch(int *keys)
+{
+	foreach(batch_index, BATCH_SIZE) {
+		int key = keys[batch_index];
+		int i;
+
+		/**< Ends the lookup: lowered to goto fpp_end */
+		if(key < 0) {
+			continue;
+		}
+
+		FPP_EXPENSIVE(&ht[key & NUM_BKT_]);
+
+		/**< Continues the inner loop: unchanged */
+		for(i = 0; i < 8; i ++) {
+			if(ht[key & NUM_BKT_].slot[i] == 0) {
+				continue;
+			}
+			sum += ht[key & NUM_BKT_].slot[i];
+		}
+
+		/**< break leaves the switch, return ends the lookup */
+		switch(key & 3) {
+		case 0:
+			succ ++;
+			break;
+		default:
+			if(key == KEY_STOP) {
+				return;
+			}
+			break;
+		}
+
+		/**< A goto inside the foreach body: unchanged */
+		if(key & 4) {
+			goto skip;
+		}
+		fail ++;
+skip:
+		nb_done ++;
+	}
+}
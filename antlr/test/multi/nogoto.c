@@ -0,0 +1,24 @@
+int hash(int a)
+{
+	return a * 2654435761u;
+}
+
+void process_keys(int *keys, int nb_keys)
+{
+	foreach(batch_index, nb_keys) {
+		int bkt = hash(keys[batch_index]) & NUM_BKT_;
+		FPP_EXPENSIVE(&ht[bkt]);
+		sum += ht[bkt];
+	}
+}
+
+void process_chains(int *heads)
+{
+	foreach(batch_index, BATCH_SIZE) {
+		int node = heads[batch_index];
+		FPP_EXPENSIVE(&next[node]);
+		node = next[node];
+		FPP_EXPENSIVE(&next[node]);
+		sum += next[node];
+	}
+}
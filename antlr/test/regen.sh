@@ -0,0 +1,6 @@
+# Regenerate the .proc outputs of the test inputs. Run from the antlr dir
+# after building the transformer.
+for dir in test/*/; do
+	java Main "$dir/nogoto.c" "$dir/nogoto.c.proc" > /dev/null ||
+		echo "Failed to transform $dir/nogoto.c"
+done
@@ -4,27 +4,25 @@
 #include<pthread.h>
 #include<stdint.h>
 #include<errno.h>
+#include<unistd.h>
 
 #include "util.h"
 #include "params.h"
+#include "stripe.h"
 
 typedef struct {
 	long long a;
 	long long b;
 } node_t;
 
-typedef struct {
-	pthread_spinlock_t lock;
-	int index;
-	long long pad[7];
-} lock_t;
-
 void *reader(void *ptr);
 void *writer(void *ptr);
+int process_batch(int *node_id);
 
 /** < Only shared variables here */
 node_t *nodes;
-lock_t *locks;
+struct stripe_set stripes;
+int *zipf_table;
 
 int main()
 {
@@ -32,9 +30,6 @@ int main()
 	int tid[NUM_THREADS];
 	pthread_t thread[NUM_THREADS];
 
-	/** < Ensure that locks are cacheline aligned */
-	assert(sizeof(lock_t) == 64);
-
 	/** < Allocate the shared nodes */
 	red_printf("Allocting %d nodes\n", NUM_NODES);
 	nodes = (node_t *) malloc(NUM_NODES * sizeof(node_t));
@@ -47,12 +42,14 @@ int main()
 
 	/** < Allocate the striped spinlocks */
 	red_printf("Allocting %d locks\n", NUM_LOCKS);
-	locks = (lock_t *) malloc(NUM_LOCKS * sizeof(lock_t));
-	assert(locks != NULL);
-	
-	for(i = 0; i < NUM_LOCKS; i++) {
-		pthread_spin_init(&locks[i].lock, 0);
-	}
+	stripe_init(&stripes, NUM_LOCKS);
+
+#if USE_ZIPF == 1
+	red_printf("Generating Zipfian nodes with theta = %f\n", ZIPF_THETA);
+	zipf_table = (int *) malloc(ZIPF_TABLE_SIZE * sizeof(int));
+	assert(zipf_table != NULL);
+	zipf_fill(zipf_table, ZIPF_TABLE_SIZE, NUM_NODES, ZIPF_THETA, 0xdeadbeef);
+#endif
 	
 	/** < Launch several reader threads and a writer thread */
 	for(i = 0; i < NUM_THREADS; i++) {
@@ -61,8 +58,32 @@ int main()
 		pthread_create(&thread[i], NULL, reader, &tid[i]);
 	}
 
-	for(i = 0; i < NUM_THREADS; i++) {
-		pthread_join(thread[i], NULL);
+	/** < The threads run forever: watch the stripes and grow them if
+	  * acquisitions start failing. If the keys of the hottest stripe are
+	  * one hot key, more stripes cannot help it: stop growing once a
+	  * doubling does not relieve the hottest stripe. */
+	double grow_busy_per_acq = 0;	/** < Hottest busy/acq before the last growth */
+	int grow_stalled = 0;
+
+	while(1) {
+		sleep(STATS_INTERVAL);
+		double hot_busy_per_acq = stripe_print_stats(&stripes, 4, GROW_MIN_ACQ);
+
+		if(grow_busy_per_acq != 0) {
+			if(hot_busy_per_acq > grow_busy_per_acq * GROW_MIN_GAIN) {
+				red_printf("Growing did not relieve the hottest stripe. "
+					"Staying at %d stripes\n", stripes.cur->num_stripes);
+				grow_stalled = 1;
+			}
+			grow_busy_per_acq = 0;
+		}
+
+		if(!grow_stalled && hot_busy_per_acq > GROW_BUSY_PER_ACQ &&
+			stripes.cur->num_stripes < MAX_LOCKS) {
+			red_printf("Growing stripes to %d\n", stripes.cur->num_stripes * 2);
+			grow_busy_per_acq = hot_busy_per_acq;
+			stripe_grow(&stripes);
+		}
 	}
 
 	exit(0);
@@ -76,11 +97,15 @@ void *reader( void *ptr)
 	int sum = 0, i;
 
 	/** < The node and lock to use in an iteration */
-	int node_id[BATCH_SIZE], lock_id[BATCH_SIZE], I;
+	int node_id[BATCH_SIZE], I;
+	struct stripe_table *table;
 
 	/** < Total number of iterations (for measurement) */
 	int num_iters = 0;
 
+	/** < Total number of failed trylocks (for measurement) */
+	int num_busy = 0;
+
 	clock_gettime(CLOCK_REALTIME, &start);
 
 	while(1) {
@@ -89,33 +114,81 @@ void *reader( void *ptr)
 			double seconds = (end.tv_sec - start.tv_sec) + 
 				(double) (end.tv_nsec - start.tv_nsec) / GHZ_CPS;
 		
-			printf("Reader thread %d: rate = %.2f M/s. Sum = %d\n", tid, 
-				num_iters / (1000000 * seconds), sum);
+			printf("Reader thread %d: rate = %.2f M/s. Sum = %d. "
+				"Busy locks per op = %f\n", tid,
+				num_iters / (1000000 * seconds), sum,
+				(double) num_busy / num_iters);
 				
 			num_iters = 0;
+			num_busy = 0;
 			clock_gettime(CLOCK_REALTIME, &start);
 		}
 
+		/** < The table may be replaced before process_batch(): this is
+		  * only a prefetch hint */
+		table = stripes.cur;
+
 		for(I = 0; I < BATCH_SIZE; I ++) {
 			for(i = 0; i < COMPUTE; i ++) {
+#if USE_ZIPF == 1
+				node_id[I] = zipf_table[fastrand(&seed) & ZIPF_TABLE_SIZE_];
+#else
 				node_id[I] = fastrand(&seed) & NUM_NODES_;
+#endif
 			}
-			lock_id[I] = node_id[I] & NUM_LOCKS_;
-			__builtin_prefetch(&locks[lock_id[I]], 0, 0);
+			__builtin_prefetch(&table->stripes[node_id[I] & table->num_stripes_], 0, 0);
 		}
 
-		for(I = 0; I < BATCH_SIZE; I ++) {
-			pthread_spin_lock(&locks[lock_id[I]].lock);
-			
-			/** < Critical section begin */
-			nodes[node_id[I]].a ++;
-			nodes[node_id[I]].b ++;
-			/** < Critical section end */
-
-			pthread_spin_unlock(&locks[lock_id[I]].lock);
-	
-			num_iters ++;
-		}
+		num_busy += process_batch(node_id);
+		num_iters += BATCH_SIZE;
+	}
+}
+
+/** < Run the critical sections for a batch of nodes. An item whose lock is
+  * busy saves its state and switches to the next item instead of spinning,
+  * so a hot stripe only delays the items that need it. Returns the number
+  * of failed trylocks. */
+int process_batch(int *node_id)
+{
+	int num_busy = 0;
+	stripe_t *stripe[BATCH_SIZE];
+	int num_fails[BATCH_SIZE] = {0};
+
+	int I = 0;			// batch index
+	void *batch_rips[BATCH_SIZE];		// goto targets
+	int iMask = 0;		// No item is done yet
+
+	int temp_index;
+	for(temp_index = 0; temp_index < BATCH_SIZE; temp_index ++) {
+		batch_rips[temp_index] = &&fpp_start;
+	}
+
+fpp_start:
+
+	stripe[I] = stripe_trylock(&stripes, node_id[I], num_fails[I]);
+	if(stripe[I] == NULL) {
+		/** < Retry this item when the batch comes back to it */
+		num_fails[I] ++;
+		num_busy ++;
+		batch_rips[I] = &&fpp_start;
+		I = (I + 1) & BATCH_SIZE_;
+		goto *batch_rips[I];
+	}
+
+	/** < Critical section begin */
+	nodes[node_id[I]].a ++;
+	nodes[node_id[I]].b ++;
+	/** < Critical section end */
+
+	stripe_unlock(stripe[I]);
+
+fpp_end:
+	batch_rips[I] = &&fpp_end;
+	iMask = FPP_SET(iMask, I);
+	if(iMask == (1 << BATCH_SIZE) - 1) {
+		return num_busy;
 	}
+	I = (I + 1) & BATCH_SIZE_;
+	goto *batch_rips[I];
 }
 
@@ -4,27 +4,24 @@
 #include<pthread.h>
 #include<stdint.h>
 #include<errno.h>
+#include<unistd.h>
 
 #include "util.h"
 #include "params.h"
+#include "stripe.h"
 
 typedef struct {
 	long long a;
 	long long b;
 } node_t;
 
-typedef struct {
-	pthread_spinlock_t lock;
-	int index;
-	long long pad[7];
-} lock_t;
-
 void *reader(void *ptr);
 void *writer(void *ptr);
 
 /** < Only shared variables here */
 node_t *nodes;
-lock_t *locks;
+struct stripe_set stripes;
+int *zipf_table;
 
 int main()
 {
@@ -32,9 +29,6 @@ int main()
 	int tid[NUM_THREADS];
 	pthread_t thread[NUM_THREADS];
 
-	/** < Ensure that locks are cacheline aligned */
-	assert(sizeof(lock_t) == 64);
-
 	/** < Allocate the shared nodes */
 	red_printf("Allocting %d nodes\n", NUM_NODES);
 	nodes = (node_t *) malloc(NUM_NODES * sizeof(node_t));
@@ -47,12 +41,14 @@ int main()
 
 	/** < Allocate the striped spinlocks */
 	red_printf("Allocting %d locks\n", NUM_LOCKS);
-	locks = (lock_t *) malloc(NUM_LOCKS * sizeof(lock_t));
-	assert(locks != NULL);
-	
-	for(i = 0; i < NUM_LOCKS; i++) {
-		pthread_spin_init(&locks[i].lock, 0);
-	}
+	stripe_init(&stripes, NUM_LOCKS);
+
+#if USE_ZIPF == 1
+	red_printf("Generating Zipfian nodes with theta = %f\n", ZIPF_THETA);
+	zipf_table = (int *) malloc(ZIPF_TABLE_SIZE * sizeof(int));
+	assert(zipf_table != NULL);
+	zipf_fill(zipf_table, ZIPF_TABLE_SIZE, NUM_NODES, ZIPF_THETA, 0xdeadbeef);
+#endif
 	
 	/** < Launch several reader threads and a writer thread */
 	for(i = 0; i < NUM_THREADS; i++) {
@@ -61,8 +57,32 @@ int main()
 		pthread_create(&thread[i], NULL, reader, &tid[i]);
 	}
 
-	for(i = 0; i < NUM_THREADS; i++) {
-		pthread_join(thread[i], NULL);
+	/** < The threads run forever: watch the stripes and grow them if
+	  * acquisitions start failing. If the keys of the hottest stripe are
+	  * one hot key, more stripes cannot help it: stop growing once a
+	  * doubling does not relieve the hottest stripe. */
+	double grow_busy_per_acq = 0;	/** < Hottest busy/acq before the last growth */
+	int grow_stalled = 0;
+
+	while(1) {
+		sleep(STATS_INTERVAL);
+		double hot_busy_per_acq = stripe_print_stats(&stripes, 4, GROW_MIN_ACQ);
+
+		if(grow_busy_per_acq != 0) {
+			if(hot_busy_per_acq > grow_busy_per_acq * GROW_MIN_GAIN) {
+				red_printf("Growing did not relieve the hottest stripe. "
+					"Staying at %d stripes\n", stripes.cur->num_stripes);
+				grow_stalled = 1;
+			}
+			grow_busy_per_acq = 0;
+		}
+
+		if(!grow_stalled && hot_busy_per_acq > GROW_BUSY_PER_ACQ &&
+			stripes.cur->num_stripes < MAX_LOCKS) {
+			red_printf("Growing stripes to %d\n", stripes.cur->num_stripes * 2);
+			grow_busy_per_acq = hot_busy_per_acq;
+			stripe_grow(&stripes);
+		}
 	}
 
 	exit(0);
@@ -76,7 +96,8 @@ void *reader( void *ptr)
 	int sum = 0, i;
 
 	/** < The node and lock to use in an iteration */
-	int node_id, lock_id;
+	int node_id;
+	stripe_t *stripe;
 
 	/** < Total number of iterations (for measurement) */
 	int num_iters = 0;
@@ -97,19 +118,21 @@ void *reader( void *ptr)
 		}
 
 		for(i = 0; i < COMPUTE; i ++) {
+#if USE_ZIPF == 1
+			node_id = zipf_table[fastrand(&seed) & ZIPF_TABLE_SIZE_];
+#else
 			node_id = fastrand(&seed) & NUM_NODES_;
+#endif
 		}
 
-		lock_id = node_id & NUM_LOCKS_;
-
-		pthread_spin_lock(&locks[lock_id].lock);
+		stripe = stripe_lock(&stripes, node_id);
 		
 		/** < Critical section begin */
 		nodes[node_id].a ++;
 		nodes[node_id].b ++;
 		/** < Critical section end */
 
-		pthread_spin_unlock(&locks[lock_id].lock);
+		stripe_unlock(stripe);
 
 		num_iters ++;
 	}
@@ -1,8 +1,20 @@
 #define NUM_THREADS 16
 #define BATCH_SIZE 8
+#define BATCH_SIZE_ (BATCH_SIZE - 1)
 
+#define FPP_SET(n, i) (n | (1 << i))	// Set the ith bit of n
+
+/** < Initial number of stripes. The stripes double (up to MAX_LOCKS) when
+  * the hottest stripe has more than GROW_BUSY_PER_ACQ failed attempts per
+  * acquisition over at least GROW_MIN_ACQ acquisitions. Growing stops for
+  * good when a doubling leaves the hottest stripe above GROW_MIN_GAIN times
+  * its earlier busy/acq, as with a single hot key. */
 #define NUM_LOCKS 4096
-#define NUM_LOCKS_ (NUM_LOCKS - 1)
+#define MAX_LOCKS (16 * 1024)
+#define GROW_BUSY_PER_ACQ 0.5
+#define GROW_MIN_ACQ 1000
+#define GROW_MIN_GAIN 0.8
+#define STATS_INTERVAL 2		/** < Seconds between stripe stats */
 
 #define NUM_NODES (1024 * 1024)
 #define NUM_NODES_ (NUM_NODES - 1)
@@ -11,3 +23,9 @@
 #define ITERS_PER_MEASUREMENT 10000000
 
 #define COMPUTE 3
+
+/** < Skewed workload: draw nodes from a Zipfian distribution */
+#define USE_ZIPF 0
+#define ZIPF_THETA 0.99
+#define ZIPF_TABLE_SIZE (16 * 1024 * 1024)
+#define ZIPF_TABLE_SIZE_ (ZIPF_TABLE_SIZE - 1)
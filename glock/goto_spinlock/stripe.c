@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+#include "stripe.h"
+
+static struct stripe_table *stripe_table_alloc(int num_stripes, int locked)
+{
+	int i;
+	assert(num_stripes > 0 && (num_stripes & (num_stripes - 1)) == 0);
+
+	/** < Ensure that stripes are cacheline aligned */
+	assert(sizeof(stripe_t) == 64);
+
+	struct stripe_table *table = malloc(sizeof(struct stripe_table));
+	assert(table != NULL);
+
+	int ret = posix_memalign((void **) &table->stripes, 64,
+		num_stripes * sizeof(stripe_t));
+	assert(ret == 0);
+
+	for(i = 0; i < num_stripes; i ++) {
+		pthread_spin_init(&table->stripes[i].lock, 0);
+		table->stripes[i].num_acq = 0;
+		table->stripes[i].num_busy = 0;
+
+		if(locked) {
+			pthread_spin_lock(&table->stripes[i].lock);
+		}
+	}
+
+	table->num_stripes = num_stripes;
+	table->num_stripes_ = num_stripes - 1;
+	return table;
+}
+
+void stripe_init(struct stripe_set *set, int num_stripes)
+{
+	set->tables[0] = stripe_table_alloc(num_stripes, 0);
+	set->num_tables = 1;
+	set->cur = set->tables[0];
+}
+
+stripe_t *stripe_trylock(struct stripe_set *set, int key, int num_fails)
+{
+	struct stripe_table *table = set->cur;
+	stripe_t *stripe = &table->stripes[key & table->num_stripes_];
+
+	if(pthread_spin_trylock(&stripe->lock) != 0) {
+		return NULL;
+	}
+
+	/** < The table may have been retired while we were acquiring */
+	if(set->cur != table) {
+		pthread_spin_unlock(&stripe->lock);
+		return NULL;
+	}
+
+	stripe->num_acq ++;
+	stripe->num_busy += num_fails;
+	return stripe;
+}
+
+stripe_t *stripe_lock(struct stripe_set *set, int key)
+{
+	int num_fails = 0;
+	stripe_t *stripe;
+
+	while((stripe = stripe_trylock(set, key, num_fails)) == NULL) {
+		num_fails ++;
+		asm volatile("pause" ::: "memory");
+	}
+
+	return stripe;
+}
+
+void stripe_unlock(stripe_t *stripe)
+{
+	pthread_spin_unlock(&stripe->lock);
+}
+
+void stripe_grow(struct stripe_set *set)
+{
+	int i;
+	struct stripe_table *old_table = set->cur;
+	struct stripe_table *new_table =
+		stripe_table_alloc(old_table->num_stripes * 2, 1);
+
+	assert(set->num_tables < STRIPE_MAX_TABLES);
+	set->tables[set->num_tables ++] = new_table;
+
+	/** < Stripe initialization --> publish */
+	__sync_synchronize();
+	set->cur = new_table;
+	__sync_synchronize();
+
+	/** < Old stripe i covers new stripes i and i + num_stripes. Once we hold
+	  * it, no locker is inside a critical section under the old table, and
+	  * later lockers of the old table fail their table check. */
+	for(i = 0; i < old_table->num_stripes; i ++) {
+		pthread_spin_lock(&old_table->stripes[i].lock);
+
+		pthread_spin_unlock(&new_table->stripes[i].lock);
+		pthread_spin_unlock(
+			&new_table->stripes[i + old_table->num_stripes].lock);
+	}
+}
+
+/** < A stripe's stats, for sorting */
+struct stripe_stat {
+	int stripe_id;
+	long long num_acq;
+	long long num_busy;
+};
+
+static int stripe_cmp_acq(const void *a, const void *b)
+{
+	long long acq_a = ((const struct stripe_stat *) a)->num_acq;
+	long long acq_b = ((const struct stripe_stat *) b)->num_acq;
+	return acq_a < acq_b ? 1 : (acq_a > acq_b ? -1 : 0);
+}
+
+double stripe_print_stats(struct stripe_set *set, int top_k, long long min_acq)
+{
+	int i;
+	struct stripe_table *table = set->cur;
+	long long tot_acq = 0, tot_busy = 0;
+
+	struct stripe_stat *stats =
+		malloc(table->num_stripes * sizeof(struct stripe_stat));
+	assert(stats != NULL);
+
+	for(i = 0; i < table->num_stripes; i ++) {
+		stats[i].stripe_id = i;
+		stats[i].num_acq = table->stripes[i].num_acq;
+		stats[i].num_busy = table->stripes[i].num_busy;
+
+		table->stripes[i].num_acq = 0;
+		table->stripes[i].num_busy = 0;
+
+		tot_acq += stats[i].num_acq;
+		tot_busy += stats[i].num_busy;
+	}
+
+	qsort(stats, table->num_stripes, sizeof(struct stripe_stat),
+		stripe_cmp_acq);
+
+	double avg_acq = (double) tot_acq / table->num_stripes;
+	double busy_per_acq = tot_acq == 0 ? 0 : (double) tot_busy / tot_acq;
+	double hot_busy_per_acq = stats[0].num_acq < min_acq ? 0 :
+		(double) stats[0].num_busy / stats[0].num_acq;
+
+	printf("stripe: %d stripes, %lld acquisitions, busy/acq = %.3f, "
+		"hottest/avg = %.2f, hottest busy/acq = %.3f\n", table->num_stripes,
+		tot_acq, busy_per_acq, avg_acq == 0 ? 0 : stats[0].num_acq / avg_acq,
+		hot_busy_per_acq);
+
+	for(i = 0; i < top_k && i < table->num_stripes; i ++) {
+		printf("\tstripe %d: acq = %lld, busy = %lld\n",
+			stats[i].stripe_id, stats[i].num_acq, stats[i].num_busy);
+	}
+
+	free(stats);
+	return hot_busy_per_acq;
+}
@@ -0,0 +1,59 @@
+#include <pthread.h>
+#include <stdint.h>
+
+/** < A set of striped spinlocks that can be grown while it is in use.
+  * Key k is protected by stripe (k & (num_stripes - 1)) of the current table.
+  * Growing publishes a table with twice the stripes, all initially locked,
+  * and then hands each old stripe over to its two new stripes. Lockers that
+  * raced with the switch notice it and retry on the new table, so only the
+  * stripe being handed over waits. Retired tables are never freed because
+  * a locker may still be reading them. */
+#define STRIPE_MAX_TABLES 16
+
+typedef struct {
+	pthread_spinlock_t lock;
+
+	/** < Stats. Only updated while holding the lock, so they live in a
+	  * cacheline that the holder already owns. */
+	long long num_acq;		/** < Acquisitions */
+	long long num_busy;		/** < Failed attempts before acquisitions */
+	long long pad[5];
+} stripe_t;
+
+struct stripe_table {
+	stripe_t *stripes;
+	int num_stripes;
+	int num_stripes_;		/** < num_stripes - 1 */
+};
+
+struct stripe_set {
+	struct stripe_table * volatile cur;
+
+	/** < All tables ever published, for the grower and for stats */
+	struct stripe_table *tables[STRIPE_MAX_TABLES];
+	int num_tables;
+};
+
+void stripe_init(struct stripe_set *set, int num_stripes);
+
+/** < Lock the stripe for key and return it */
+stripe_t *stripe_lock(struct stripe_set *set, int key);
+
+/** < Try once to lock the stripe for key. Returns NULL if it is busy.
+  * num_fails is the number of earlier failed attempts for this key, and is
+  * charged to the stripe on success. */
+stripe_t *stripe_trylock(struct stripe_set *set, int key, int num_fails);
+
+void stripe_unlock(stripe_t *stripe);
+
+/** < Double the number of stripes without stopping lockers. Must not be
+  * called concurrently with itself. */
+void stripe_grow(struct stripe_set *set);
+
+/** < Print per-stripe stats since the last call and reset them. Returns the
+  * failed attempts per acquisition of the hottest stripe (the one with the
+  * most acquisitions), or 0 if it had fewer than min_acq acquisitions.
+  * Spreading keys over more stripes only helps if that stripe is contended:
+  * a high average can also come from preempted lock holders. Counters are
+  * reset without the lock, so the numbers are approximate. */
+double stripe_print_stats(struct stripe_set *set, int top_k, long long min_acq);
@@ -1,3 +1,5 @@
+#include <math.h>
+
 #include "util.h"
 
 // Like printf, but red. Limited to 1000 characters.
@@ -39,3 +41,36 @@ inline uint32_t fastrand(uint64_t* seed)
     *seed = *seed * 1103515245 + 12345;
     return (uint32_t)(*seed >> 32);
 }
+
+/** < Uses the generator from Gray et al., "Quickly generating billion-record
+  * synthetic databases" (also used by YCSB). Key 0 is the hottest. */
+void zipf_fill(int *table, int table_size, int n, double theta, uint64_t seed)
+{
+	int i;
+	double zetan = 0, zeta2 = 1 + pow(0.5, theta);
+
+	assert(n >= 2 && theta > 0 && theta < 1);
+
+	for(i = 1; i <= n; i ++) {
+		zetan += 1 / pow(i, theta);
+	}
+
+	double alpha = 1 / (1 - theta);
+	double eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetan);
+
+	for(i = 0; i < table_size; i ++) {
+		double u = (double) fastrand(&seed) / 4294967296.0;
+		double uz = u * zetan;
+
+		if(uz < 1) {
+			table[i] = 0;
+		} else if(uz < zeta2) {
+			table[i] = 1;
+		} else {
+			table[i] = (int) (n * pow(eta * u - eta + 1, alpha));
+			if(table[i] >= n) {
+				table[i] = n - 1;
+			}
+		}
+	}
+}
@@ -6,3 +6,7 @@
 
 void red_printf(const char *format, ...);
 inline uint32_t fastrand(uint64_t* seed);
+
+/** < Zipfian keys in [0, n) with skew theta, precomputed into a table so
+  * that threads can sample them with one fastrand() */
+void zipf_fill(int *table, int table_size, int n, double theta, uint64_t seed);
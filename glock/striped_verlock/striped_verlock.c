@@ -6,6 +6,8 @@
 
 #include "city.h"
 #include "util.h"
+#include "fpp.h"
+#include "verlock.h"
 
 #define NUM_THREADS 4
 #define WRITER_COMPUTE 1
@@ -19,9 +21,25 @@
 #define GHZ_CPS 1000000000
 #define ITERS_PER_MEASUREMENT 10000000
 
+#define USE_BULK_READ 1		/** < Should readers use verlock_read_bulk()? */
+
+/** < The writer sorts this many updates by stripe and bumps each stripe's
+  * version once for all its updates in the batch. A stripe only gets more
+  * than one update per batch when the batch is large compared to the number
+  * of stripes: with B random updates over S stripes, a batch bumps about
+  * S * (1 - e^(-B / S)) stripes. B = 32, S = 1024 gives 1.97 bumps per
+  * update (vs. 2 without batching), and B = 4S gives 0.49. */
+#define WRITER_BATCH_PER_STRIPE 4
+#define WRITER_BATCH (WRITER_BATCH_PER_STRIPE * NUM_LOCKS)
+
+/** < Extra 8-byte words per node, to test records larger than 16 bytes */
+#define NODE_EXTRA_WORDS 0
+
+/** < Invariant: b == a + 1 and extra[i] == a + 2 + i */
 typedef struct {
 	long long a;
 	long long b;
+	long long extra[NODE_EXTRA_WORDS];
 } node_t;
 
 typedef struct {
@@ -31,6 +49,9 @@ typedef struct {
 
 void *reader(void *ptr);
 void *writer(void *ptr);
+int verlock_read_bulk(int *node_ids, node_t *snapshots, int n);
+static inline void node_set(node_t *node, long long a);
+static inline void node_check(node_t *node);
 
 /** < Only shared variables here */
 node_t *nodes;
@@ -51,8 +72,7 @@ int main()
 	assert(nodes != NULL);
 	
 	for(i = 0; i < NUM_NODES; i ++) {
-		nodes[i].a = rand();
-		nodes[i].b = nodes[i].a + 1;
+		node_set(&nodes[i], rand());
 	}
 
 	/** < Allocate the striped spinlocks */
@@ -94,9 +114,13 @@ void *reader( void *ptr)
 	int node_id, lock_id;
 
 	/** < The snapshotted lock version and node data */
-	int lock_version;
+	long long lock_version;
 	node_t node_snapshot;
 
+	/** < The nodes and snapshots for verlock_read_bulk() */
+	int i, batch_node_id[BATCH_SIZE];
+	node_t batch_snapshot[BATCH_SIZE];
+
 	/** < Total number of times we start the snapshotting procedure */
 	int num_tries = 0;
 
@@ -106,7 +130,7 @@ void *reader( void *ptr)
 	clock_gettime(CLOCK_REALTIME, &start);
 
 	while(1) {
-		if(num_iters == ITERS_PER_MEASUREMENT) {
+		if(num_iters >= ITERS_PER_MEASUREMENT) {
 			clock_gettime(CLOCK_REALTIME, &end);
 			double seconds = (end.tv_sec - start.tv_sec) + 
 				(double) (end.tv_nsec - start.tv_nsec) / GHZ_CPS;
@@ -120,6 +144,22 @@ void *reader( void *ptr)
 			clock_gettime(CLOCK_REALTIME, &start);
 		}
 
+#if USE_BULK_READ == 1
+		for(i = 0; i < BATCH_SIZE; i ++) {
+			batch_node_id[i] = fastrand(&seed) & NUM_NODES_;
+		}
+
+		num_tries += verlock_read_bulk(batch_node_id, batch_snapshot, BATCH_SIZE);
+
+		for(i = 0; i < BATCH_SIZE; i ++) {
+			node_check(&batch_snapshot[i]);
+			sum += batch_snapshot[i].a + batch_snapshot[i].b;
+		}
+
+		num_iters += BATCH_SIZE;
+		continue;
+#endif
+
 		node_id = fastrand(&seed) & NUM_NODES_;
 		lock_id = node_id & NUM_LOCKS_;
 
@@ -127,23 +167,16 @@ try_again:
 		num_tries ++;
 
 		/** < Enter the critical section when the version is even */
-		lock_version = locks[lock_id].lock; 
+		lock_version = verlock_read_begin(&locks[lock_id].lock);
 		if((lock_version & 1) != 0) {
 			goto try_again;
 		}
-	
-		/** < version load #1 --> snapshot loads */
-		asm volatile("" ::: "memory");
 
-		node_snapshot.a = nodes[node_id].a;
-		node_snapshot.b = nodes[node_id].b;
-	
-		/** < snapshot loads --> version load #2 */
-		asm volatile("" ::: "memory");
+		verlock_copy(&node_snapshot, &nodes[node_id], sizeof(node_t));
 
-		if(locks[lock_id].lock == lock_version) {
+		if(verlock_read_validate(&locks[lock_id].lock, lock_version)) {
 			// Snapshot was correct
-			assert(node_snapshot.b == node_snapshot.a + 1);
+			node_check(&node_snapshot);
 			sum += node_snapshot.a + node_snapshot.b;
 		} else {
 			goto try_again;
@@ -159,18 +192,23 @@ void *writer( void *ptr)
 	struct timespec start, end;
 	int tid = *((int *) ptr);
 	uint64_t seed = 0xdeadbeef + tid;
-	int sum = 0;
 
-	/** < The node and lock to use in an iteration */
-	int i, node_id, lock_id;
+	/** < The nodes to update in an iteration, sorted by stripe with a
+	  * counting sort: stripe_start[l] is the first update to stripe l */
+	int i, j, k, node_id, lock_id;
+	static int new_node_id[WRITER_BATCH], batch_node_id[WRITER_BATCH];
+	static int stripe_start[NUM_LOCKS + 1];
 	
 	/** < Total number of iterations (for measurement) */
 	int num_iters = 0;
 
+	/** < Total number of version bumps (for measurement) */
+	int num_bumps = 0;
+
 	clock_gettime(CLOCK_REALTIME, &start);
 
 	while(1) {
-		if(num_iters == ITERS_PER_MEASUREMENT) {
+		if(num_iters >= ITERS_PER_MEASUREMENT) {
 			clock_gettime(CLOCK_REALTIME, &end);
 			double seconds = (end.tv_sec - start.tv_sec) + 
 				(double) (end.tv_nsec - start.tv_nsec) / GHZ_CPS;
@@ -178,34 +216,127 @@ void *writer( void *ptr)
 			node_id = fastrand(&seed) & NUM_NODES_;
 
 			red_printf("Writer thread %d: rate = %.2f M/s. "
+				"Version bumps per update = %.2f. "
 				"Random node: (%lld, %lld)\n", tid, 
 				num_iters / (1000000 * seconds),
+				(double) num_bumps / num_iters,
 				nodes[node_id].a, nodes[node_id].b);
 				
 			num_iters = 0;
+			num_bumps = 0;
 			clock_gettime(CLOCK_REALTIME, &start);
 		}
 
-		node_id = fastrand(&seed) & NUM_NODES_;
-		lock_id = node_id & NUM_LOCKS_;
+		for(i = 0; i <= NUM_LOCKS; i ++) {
+			stripe_start[i] = 0;
+		}
 
-		locks[lock_id].lock ++;
+		for(i = 0; i < WRITER_BATCH; i ++) {
+			new_node_id[i] = fastrand(&seed) & NUM_NODES_;
+			stripe_start[(new_node_id[i] & NUM_LOCKS_) + 1] ++;
+		}
 
-		/** < version store #1 --> node stores */
-		asm volatile("" ::: "memory");
+		for(i = 1; i <= NUM_LOCKS; i ++) {
+			stripe_start[i] += stripe_start[i - 1];
+		}
 
-		/** < Update node.a and node.b after some expensive computation */
-		for(i = 0; i < WRITER_COMPUTE; i ++) {
-			nodes[node_id].a = CityHash32((char *) &nodes[node_id].a, 4);
+		for(i = 0; i < WRITER_BATCH; i ++) {
+			batch_node_id[stripe_start[new_node_id[i] & NUM_LOCKS_] ++] =
+				new_node_id[i];
 		}
 
-		nodes[node_id].b = nodes[node_id].a + 1;
-		
-		/** < node stores --> version store #2 */
-		asm volatile("" ::: "memory");
+		/** < One version bump per group of updates to the same stripe */
+		for(i = 0; i < WRITER_BATCH; i = j) {
+			lock_id = batch_node_id[i] & NUM_LOCKS_;
+			verlock_write_begin(&locks[lock_id].lock);
 
-		locks[lock_id].lock ++;
+			for(j = i; j < WRITER_BATCH &&
+				(batch_node_id[j] & NUM_LOCKS_) == lock_id; j ++) {
+				node_id = batch_node_id[j];
 
-		num_iters ++;
+				/** < Update the node after some expensive computation */
+				long long a = nodes[node_id].a;
+				for(k = 0; k < WRITER_COMPUTE; k ++) {
+					a = CityHash32((char *) &a, 4);
+				}
+
+				node_set(&nodes[node_id], a);
+			}
+
+			verlock_write_end(&locks[lock_id].lock);
+			num_bumps += 2;
+		}
+
+		num_iters += WRITER_BATCH;
+	}
+}
+
+static inline void node_set(node_t *node, long long a)
+{
+	int i;
+	node->a = a;
+	node->b = a + 1;
+	for(i = 0; i < NODE_EXTRA_WORDS; i ++) {
+		node->extra[i] = a + 2 + i;
+	}
+}
+
+static inline void node_check(node_t *node)
+{
+	int i;
+	assert(node->b == node->a + 1);
+	for(i = 0; i < NODE_EXTRA_WORDS; i ++) {
+		assert(node->extra[i] == node->a + 2 + i);
+	}
+}
+
+/** < Take consistent snapshots of nodes[node_ids[0 ... n - 1]], n <= BATCH_SIZE.
+  * The lock word and node of every item are prefetched before any item is
+  * read. An item whose stripe is being written, or whose version changed
+  * during the snapshot, yields to the other items and retries later, so one
+  * busy stripe does not stall the batch. Returns the number of attempts. */
+int verlock_read_bulk(int *node_ids, node_t *snapshots, int n)
+{
+	int lock_id[BATCH_SIZE];
+	long long lock_version[BATCH_SIZE];
+	int num_tries = 0;
+
+	int I = 0;			// batch index
+	void *batch_rips[BATCH_SIZE];		// goto targets
+	int iMask = 0;		// No item is done yet
+
+	int temp_index;
+	for(temp_index = 0; temp_index < BATCH_SIZE; temp_index ++) {
+		batch_rips[temp_index] = &&fpp_start;
+	}
+
+fpp_start:
+
+	lock_id[I] = node_ids[I] & NUM_LOCKS_;
+	__builtin_prefetch(&nodes[node_ids[I]], 0, 0);
+	FPP_PSS(&locks[lock_id[I]], fpp_label_1, n);
+fpp_label_1:
+
+	num_tries ++;
+
+	/** < Enter the critical section when the version is even */
+	lock_version[I] = verlock_read_begin(&locks[lock_id[I]].lock);
+	if((lock_version[I] & 1) != 0) {
+		FPP_PSS(&locks[lock_id[I]], fpp_label_1, n);
+	}
+
+	verlock_copy(&snapshots[I], &nodes[node_ids[I]], sizeof(node_t));
+
+	if(!verlock_read_validate(&locks[lock_id[I]].lock, lock_version[I])) {
+		FPP_PSS(&locks[lock_id[I]], fpp_label_1, n);
+	}
+
+fpp_end:
+	batch_rips[I] = &&fpp_end;
+	iMask = FPP_SET(iMask, I);
+	if(iMask == (1 << n) - 1) {
+		return num_tries;
 	}
+	I = (I + 1) < n ? I + 1 : 0;
+	goto *batch_rips[I];
 }
@@ -0,0 +1,47 @@
+/** < Seqlock primitives for the striped version locks. A version is odd
+  * while the writer updates the nodes that it covers. The fences compile
+  * to plain compiler barriers on x86, but keep the protocol correct on
+  * weaker memory models. */
+
+/** < Version load #1 --> snapshot loads */
+static inline long long verlock_read_begin(volatile long long *version)
+{
+	return __atomic_load_n(version, __ATOMIC_ACQUIRE);
+}
+
+/** < Snapshot loads --> version load #2. Returns 1 iff the snapshot taken
+  * since verlock_read_begin() returned start is consistent. */
+static inline int verlock_read_validate(volatile long long *version,
+	long long start)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return (start & 1) == 0 &&
+		__atomic_load_n(version, __ATOMIC_RELAXED) == start;
+}
+
+/** < Version store #1 --> node stores. Only one writer per stripe. */
+static inline void verlock_write_begin(volatile long long *version)
+{
+	long long cur = __atomic_load_n(version, __ATOMIC_RELAXED);
+	__atomic_store_n(version, cur + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/** < Node stores --> version store #2 */
+static inline void verlock_write_end(volatile long long *version)
+{
+	long long cur = __atomic_load_n(version, __ATOMIC_RELAXED);
+	__atomic_store_n(version, cur + 1, __ATOMIC_RELEASE);
+}
+
+/** < Copy a record of any size that may be written concurrently. Words are
+  * loaded individually so that the compiler cannot tear or merge them. */
+static inline void verlock_copy(void *dst, void *src, int size)
+{
+	int i;
+	long long *dst_w = (long long *) dst, *src_w = (long long *) src;
+
+	for(i = 0; i < (int) (size / sizeof(long long)); i ++) {
+		dst_w[i] = __atomic_load_n(&src_w[i], __ATOMIC_RELAXED);
+	}
+}
@@ -2,6 +2,96 @@
 #define MAX_CLT_TX_BURST 16
 #define MAX_CLT_RX_BURST 16
 
+/**< Latency histograms are merged across lcores and dumped to
+  *  CLT_HIST_DIR/client<id>_<interval>.hist once per interval */
+#define CLT_HIST_INTERVAL_US 1000000
+#define CLT_HIST_DIR "lat"
+
+/**< An lcore records into hist[interval % 2]. When it moves to the next
+  *  interval, it publishes nb_done and then resets the other histogram. The
+  *  master lcore merges interval k once every lcore is done with it, and
+  *  discards the merge if an lcore had moved on to interval k + 2 (which
+  *  reuses k's histogram) by the time the merge finished. */
+struct clt_lat {
+	struct hist hist[2];
+	volatile LL nb_done;	/**< Intervals 0 to nb_done - 1 are complete */
+} __rte_cache_aligned;
+
+static struct clt_lat clt_lat[RTE_MAX_LCORE];
+static volatile LL clt_epoch_tsc;	/**< Start of interval 0 */
+
+/**< Move lcore_id's histograms from interval cur to interval next */
+static void clt_hist_rotate(int lcore_id, LL cur, LL next)
+{
+	struct clt_lat *lat = &clt_lat[lcore_id];
+
+	lat->nb_done = next;
+	__sync_synchronize();
+
+	hist_reset(&lat->hist[next % 2]);
+
+	/**< Intervals between cur and next had no samples */
+	if(next > cur + 1) {
+		hist_reset(&lat->hist[(next + 1) % 2]);
+	}
+}
+
+/**< Returns 1 if all lcores are done with interval */
+static int clt_hist_ready(LL interval)
+{
+	int lid;
+	for(lid = 0; lid < RTE_MAX_LCORE; lid ++) {
+		if(rte_lcore_is_enabled(lid) && clt_lat[lid].nb_done <= interval) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**< Merge interval's histograms, print percentiles and dump the histogram */
+static void clt_hist_report(int client_id, LL interval)
+{
+	static struct hist merged;
+	char filename[100];
+	int lid;
+
+	hist_reset(&merged);
+	for(lid = 0; lid < RTE_MAX_LCORE; lid ++) {
+		if(rte_lcore_is_enabled(lid)) {
+			hist_merge(&merged, &clt_lat[lid].hist[interval % 2]);
+		}
+	}
+
+	__sync_synchronize();
+	for(lid = 0; lid < RTE_MAX_LCORE; lid ++) {
+		if(rte_lcore_is_enabled(lid) && clt_lat[lid].nb_done > interval + 1) {
+			red_printf("Client %d: latency interval %lld overwritten. Skipping.\n",
+				client_id, interval);
+			return;
+		}
+	}
+
+	red_printf("Client %d, interval %lld: samples = %lld, latency (us): "
+		"p50 = %.2f, p99 = %.2f, p99.9 = %.2f, max = %.2f\n",
+		client_id, interval, merged.nb_samples,
+		hist_percentile(&merged, 50) / 1000.0,
+		hist_percentile(&merged, 99) / 1000.0,
+		hist_percentile(&merged, 99.9) / 1000.0,
+		merged.max / 1000.0);
+
+	sprintf(filename, "%s/client%d_%lld.hist", CLT_HIST_DIR, client_id, interval);
+	FILE *fp = fopen(filename, "w");
+	if(fp == NULL) {
+		red_printf("Client %d: cannot open %s\n", client_id, filename);
+		return;
+	}
+
+	fprintf(fp, "# client %d interval %lld, %lld samples, latency in ns\n",
+		client_id, interval, merged.nb_samples);
+	hist_dump(&merged, fp);
+	fclose(fp);
+}
+
 void run_client(int client_id, struct rte_mempool **l2fwd_pktmbuf_pool)
 {
 	/**< [xia-router0 - xge0,1,2,3], [xia-router1 - xge0,1,2,3] */
@@ -42,16 +132,61 @@ void run_client(int client_id, struct rte_mempool **l2fwd_pktmbuf_pool)
 	struct ipv4_hdr *ip_hdr;
 	uint8_t *src_mac_ptr, *dst_mac_ptr;
 
-	LL rx_samples = 0, latency_tot = 0;
+	LL rx_samples = 0;
 	uint64_t rss_seed = 0xdeadbeef;
 
 	/**< sizeof(ether_hdr) + sizeof(ipv6_hdr) is 54 --> 56 for 4 byte align */
 	int hdr_size = 36;
 
+	/**< Open-loop pacing: a burst is scheduled every sleep_us whether or not
+	  *  the replies to earlier bursts have arrived, and latency is measured
+	  *  from the scheduled time. A client that falls behind its schedule
+	  *  then reports the delay instead of hiding it (coordinated omission). */
 	float sleep_us = 2;
+	LL burst_cycles = (LL) (sleep_us * 1000 / C_FAC);
+	LL next_tx_tsc = rte_rdtsc();
+
+	/**< Latency histograms */
+	int is_reporter = (lcore_id == (int) rte_get_master_lcore());
+	if(is_reporter) {
+		mkdir(CLT_HIST_DIR, 0755);
+	}
+
+	__sync_bool_compare_and_swap(&clt_epoch_tsc, 0, next_tx_tsc);
+	LL interval_cycles = (LL) (CLT_HIST_INTERVAL_US * 1000 / C_FAC);
+	LL cur_interval = (next_tx_tsc - clt_epoch_tsc) / interval_cycles;
+	LL report_interval = cur_interval;
+	clt_hist_rotate(lcore_id, cur_interval - 1, cur_interval);
+	struct hist *hist = &clt_lat[lcore_id].hist[cur_interval % 2];
 
 	while (1) {
 
+		/**< RX drain. Keep polling until the next burst is due. */
+		int nb_rx_new;
+		do {
+			nb_rx_new = rte_eth_rx_burst(port_id, 
+				queue_id, rx_pkts_burst, MAX_CLT_RX_BURST);
+
+			cur_tsc = rte_rdtsc();
+			nb_rx += nb_rx_new;
+			for(i = 0; i < nb_rx_new; i ++) {
+				/**< Verify the server's response */
+				int *magic = (int *) (rte_pktmbuf_mtod(rx_pkts_burst[i], char *) + 
+					hdr_size);
+				int tx_magic = magic[0];
+
+				/**< Retrive send-TSC and lcore from which this pkt was sent */
+				LL *clt_tsc = (LL *) (rte_pktmbuf_mtod(rx_pkts_burst[i], char *) +
+					hdr_size + 4);
+				if(client_id * 1000 + lcore_id == tx_magic) {
+					rx_samples ++;
+					hist_record(hist, (ULL) (C_FAC * (cur_tsc - clt_tsc[0])));
+				}
+
+				rte_pktmbuf_free(rx_pkts_burst[i]);
+			}
+		} while(nb_rx_new > 0 || cur_tsc < next_tx_tsc);
+
 		for(i = 0; i < MAX_CLT_TX_BURST; i ++) {
 			tx_pkts_burst[i] = rte_pktmbuf_alloc(l2fwd_pktmbuf_pool[lcore_id]);
 			CPE(tx_pkts_burst[i] == NULL, "tx_alloc failed\n");
@@ -85,10 +220,10 @@ void run_client(int client_id, struct rte_mempool **l2fwd_pktmbuf_pool)
 				hdr_size);
 			magic[0] = client_id * 1000 + lcore_id;		/**< 36 -> 40 */
 			
-			/**< Add client tsc */
+			/**< Add the burst's scheduled TX time */
 			LL *clt_tsc = (LL *) (rte_pktmbuf_mtod(tx_pkts_burst[i], char *) +
 				hdr_size + 4);
-			clt_tsc[0] = rte_rdtsc();	/**< 40 -> 48 */
+			clt_tsc[0] = next_tx_tsc;	/**< 40 -> 48 */
 
 			/**< Add an integer as a dummy request */
 			int *req = (int *) (rte_pktmbuf_mtod(tx_pkts_burst[i], char *) +
@@ -103,34 +238,20 @@ void run_client(int client_id, struct rte_mempool **l2fwd_pktmbuf_pool)
 			rte_pktmbuf_free(tx_pkts_burst[i]);
 		}
 
-		micro_sleep(sleep_us, C_FAC);
+		next_tx_tsc += burst_cycles;
 
-		/**< RX drain */
-		while(1) {
-			int nb_rx_new = rte_eth_rx_burst(port_id, 
-				queue_id, rx_pkts_burst, MAX_CLT_RX_BURST);
-			if(nb_rx_new == 0) {
-				break;
-			}
-
-			nb_rx += nb_rx_new;
-			for(i = 0; i < nb_rx_new; i ++) {
-				/**< Verify the server's response */
-				int *magic = (int *) (rte_pktmbuf_mtod(rx_pkts_burst[i], char *) + 
-					hdr_size);
-				int tx_magic = magic[0];
-
-				/**< Retrive send-TSC and lcore from which this pkt was sent */
-				LL *clt_tsc = (LL *) (rte_pktmbuf_mtod(rx_pkts_burst[i], char *) +
-					hdr_size + 4);
-				if(client_id * 1000 + lcore_id == tx_magic) {
-					rx_samples ++;
-					LL cur_tsc = rte_rdtsc();
-					latency_tot += (cur_tsc - clt_tsc[0]);
-				}
+		/**< Latency intervals */
+		LL interval = (cur_tsc - clt_epoch_tsc) / interval_cycles;
+		if(unlikely(interval != cur_interval)) {
+			clt_hist_rotate(lcore_id, cur_interval, interval);
+			cur_interval = interval;
+			hist = &clt_lat[lcore_id].hist[cur_interval % 2];
+		}
 
-				rte_pktmbuf_free(rx_pkts_burst[i]);
-			}
+		if(is_reporter && report_interval < cur_interval &&
+			clt_hist_ready(report_interval)) {
+			clt_hist_report(client_id, report_interval);
+			report_interval ++;
 		}
 
 		/**< Print TX stats : because clients rarely process RX pkts */
@@ -139,20 +260,20 @@ void run_client(int client_id, struct rte_mempool **l2fwd_pktmbuf_pool)
 			double nanoseconds = C_FAC * (cur_tsc - prev_tsc);
 			prev_tsc = cur_tsc;
 
-			printf("Lcore %d: TX = %.2f, latency = %.2f us, sleep = %.2f\n"
+			printf("Lcore %d: TX = %.2f, sleep = %.2f, lag = %.2f us\n"
 				"\tnb_rx = %lld, magic passed = %lld\n",
-				lcore_id, nb_tx / (nanoseconds / GHZ_CPS),
-				(C_FAC * (latency_tot / (rx_samples + .01))) / 1000, sleep_us,
+				lcore_id, nb_tx / (nanoseconds / GHZ_CPS), sleep_us,
+				cur_tsc > next_tx_tsc ? C_FAC * (cur_tsc - next_tx_tsc) / 1000 : 0,
 				nb_rx, rx_samples);
 			
 			nb_tx = 0;
 
 			nb_rx = 0;
 			rx_samples = 0;
-			latency_tot = 0;
 
 			/**< Update sleep_us by reading the "sleep_time" file */
 			sleep_us = get_sleep_time();
+			burst_cycles = (LL) (sleep_us * 1000 / C_FAC);
 		}
 	}
 }
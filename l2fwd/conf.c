@@ -0,0 +1,268 @@
+/* Config-file driven port and lcore setup for runs without the testbed */
+#include "main.h"
+#include <rte_ring.h>
+#include <rte_eth_ring.h>
+
+/**< Parse a MAC written as 00:1B:21:BB:10:6C, or as the ULL used by
+  *  set_mac() (0x6c10bb211b00). */
+static ULL conf_parse_mac(const char *str, int line_no)
+{
+	unsigned int b[6];
+	char *end;
+	int i;
+
+	if(sscanf(str, "%x:%x:%x:%x:%x:%x",
+		&b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) == 6) {
+		ULL mac = 0;
+		for(i = 0; i < 6; i ++) {
+			CPE1(b[i] > 0xff, "Bad MAC on config line %d\n", line_no);
+			mac |= (ULL) b[i] << (i * 8);
+		}
+		return mac;
+	}
+
+	ULL mac = strtoull(str, &end, 0);
+	CPE1(*end != 0 || end == str, "Bad MAC on config line %d\n", line_no);
+	return mac;
+}
+
+static int conf_parse_id(const char *str, int max, int line_no)
+{
+	char *end;
+	long id = strtol(str, &end, 0);
+	CPE1(*end != 0 || end == str || id < 0 || id >= max,
+		"Bad port or lcore id on config line %d\n", line_no);
+	return (int) id;
+}
+
+static double conf_parse_double(const char *str, int line_no)
+{
+	char *end;
+	double val = strtod(str, &end);
+	CPE1(*end != 0 || end == str || val < 0,
+		"Bad number on config line %d\n", line_no);
+	return val;
+}
+
+struct l2fwd_conf *conf_load(const char *filename)
+{
+	char line[CONF_MAX_LINE];
+	int line_no = 0;
+
+	FILE *fp = fopen(filename, "r");
+	CPE1(fp == NULL, "Cannot open config file %s\n", filename);
+
+	struct l2fwd_conf *conf = calloc(1, sizeof(struct l2fwd_conf));
+	assert(conf != NULL);
+
+	conf->gen_profile = GEN_PROFILE_DEFAULT;
+	conf->gen_nb_flows = M_1;
+	conf->gen_nb_keys = STAGE_CUCKOO_NUM_KEYS - 1;	/**< Keys 1 to 2^24 - 1 */
+
+	while(fgets(line, CONF_MAX_LINE, fp) != NULL) {
+		char *tok[4];
+		int nb_tok = 0;
+		line_no ++;
+
+		/**< Strip comments and split into whitespace-separated tokens */
+		char *hash = strchr(line, '#');
+		if(hash != NULL) {
+			*hash = 0;
+		}
+
+		char *save, *t = strtok_r(line, " \t\r\n", &save);
+		while(t != NULL && nb_tok < 4) {
+			tok[nb_tok ++] = t;
+			t = strtok_r(NULL, " \t\r\n", &save);
+		}
+		CPE1(t != NULL, "Too many fields on config line %d\n", line_no);
+
+		if(nb_tok == 0) {
+			continue;
+		}
+
+		if(strcmp(tok[0], "srv_port") == 0 || strcmp(tok[0], "gen_port") == 0) {
+			/**< srv_port|gen_port <port_id> <src_mac> <dst_mac> */
+			CPE1(nb_tok != 4, "Usage: %s <port_id> <src_mac> <dst_mac>\n",
+				tok[0]);
+			int port_id = conf_parse_id(tok[1], RTE_MAX_ETHPORTS, line_no);
+			int used_mask = conf->srv_port_mask | conf->gen_port_mask;
+			CPE1(ISSET(used_mask, port_id),
+				"Port %d is configured twice\n", port_id);
+
+			if(tok[0][0] == 's') {
+				conf->srv_port_mask |= (1 << port_id);
+			} else {
+				conf->gen_port_mask |= (1 << port_id);
+			}
+
+			conf->src_mac[port_id] = conf_parse_mac(tok[2], line_no);
+			conf->dst_mac[port_id] = conf_parse_mac(tok[3], line_no);
+		} else if(strcmp(tok[0], "srv_lcore") == 0 ||
+			strcmp(tok[0], "rx_lcore") == 0 ||
+			strcmp(tok[0], "lookup_lcore") == 0 ||
+			strcmp(tok[0], "tx_lcore") == 0) {
+			/**< srv_lcore|rx_lcore|lookup_lcore|tx_lcore <lcore_id> */
+			CPE1(nb_tok != 2, "Usage: %s <lcore_id>\n", tok[0]);
+			int lcore_id = conf_parse_id(tok[1], RTE_MAX_LCORE, line_no);
+			CPE1(conf->role[lcore_id] != CONF_ROLE_NONE,
+				"Lcore %d is configured twice\n", lcore_id);
+
+			switch(tok[0][0]) {
+			case 's':
+				conf->role[lcore_id] = CONF_ROLE_SRV;
+				break;
+			case 'r':
+				conf->role[lcore_id] = CONF_ROLE_RX;
+				conf->pipeline = 1;
+				break;
+			case 'l':
+				conf->role[lcore_id] = CONF_ROLE_LOOKUP;
+				conf->pipeline = 1;
+				break;
+			default:
+				conf->role[lcore_id] = CONF_ROLE_TX;
+				conf->pipeline = 1;
+				break;
+			}
+
+			if(tok[0][0] == 's' || tok[0][0] == 'r') {
+				conf->nb_srv_lcores ++;
+			}
+		} else if(strcmp(tok[0], "gen_lcore") == 0) {
+			/**< gen_lcore <lcore_id> <port_id> */
+			CPE(nb_tok != 3, "Usage: gen_lcore <lcore_id> <port_id>\n");
+			int lcore_id = conf_parse_id(tok[1], RTE_MAX_LCORE, line_no);
+			CPE1(conf->role[lcore_id] != CONF_ROLE_NONE,
+				"Lcore %d is configured twice\n", lcore_id);
+
+			conf->role[lcore_id] = CONF_ROLE_GEN;
+			conf->gen_port[lcore_id] =
+				conf_parse_id(tok[2], RTE_MAX_ETHPORTS, line_no);
+		} else if(strcmp(tok[0], "ring_pair") == 0) {
+			/**< ring_pair <port_id_a> <port_id_b> */
+			CPE(nb_tok != 3, "Usage: ring_pair <port_id_a> <port_id_b>\n");
+			CPE(conf->nb_ring_pairs == CONF_MAX_RING_PAIRS,
+				"Too many ring pairs\n");
+
+			int *pair = conf->ring_pair[conf->nb_ring_pairs ++];
+			pair[0] = conf_parse_id(tok[1], RTE_MAX_ETHPORTS, line_no);
+			pair[1] = conf_parse_id(tok[2], RTE_MAX_ETHPORTS, line_no);
+		} else if(strcmp(tok[0], "gen_rate") == 0) {
+			/**< gen_rate <packets per second per generator lcore> */
+			CPE(nb_tok != 2, "Usage: gen_rate <pps>\n");
+			conf->gen_rate = conf_parse_double(tok[1], line_no);
+		} else if(strcmp(tok[0], "gen_profile") == 0) {
+			/**< gen_profile <ipv4|ipv6|key|ndn|snort> */
+			CPE(nb_tok != 2, "Usage: gen_profile <name>\n");
+			conf->gen_profile = gen_profile_find(tok[1]);
+			CPE1(conf->gen_profile < 0, "Unknown generator profile %s\n",
+				tok[1]);
+		} else if(strcmp(tok[0], "gen_flows") == 0 ||
+			strcmp(tok[0], "gen_keys") == 0) {
+			/**< gen_flows|gen_keys <count> [zipf theta] */
+			CPE1(nb_tok != 2 && nb_tok != 3, "Usage: %s <count> [theta]\n",
+				tok[0]);
+			int count = conf_parse_id(tok[1], M_1024, line_no);
+			double theta = nb_tok == 3 ? conf_parse_double(tok[2], line_no) : 0;
+			CPE1(count == 0 || theta < 0 || theta >= 1,
+				"Bad count or zipf theta on config line %d\n", line_no);
+
+			if(tok[0][4] == 'f') {
+				conf->gen_nb_flows = count;
+				conf->gen_flow_theta = theta;
+			} else {
+				conf->gen_nb_keys = count;
+				conf->gen_key_theta = theta;
+			}
+		} else {
+			CPE2(1, "Unknown keyword %s on config line %d\n", tok[0], line_no);
+		}
+	}
+
+	fclose(fp);
+
+	CPE(conf->srv_port_mask == 0, "Config has no srv_port\n");
+	/**< srv_mac_ints_init spreads the 4 lookup results over the srv_ports */
+	CPE(bitcount(conf->srv_port_mask) > 4, "Config has more than 4 srv_ports\n");
+	CPE(conf->nb_srv_lcores == 0, "Config has no srv_lcore or rx_lcore\n");
+
+	int lcore_id, nb_role[CONF_ROLE_TX + 1] = {0};
+	for(lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id ++) {
+		nb_role[conf->role[lcore_id]] ++;
+		if(conf->role[lcore_id] == CONF_ROLE_GEN) {
+			CPE1(!ISSET(conf->gen_port_mask, conf->gen_port[lcore_id]),
+				"Generator lcore %d uses a port that is not a gen_port\n",
+				lcore_id);
+		}
+	}
+
+	if(conf->pipeline) {
+		CPE(nb_role[CONF_ROLE_SRV] != 0,
+			"srv_lcore cannot be used with rx/lookup/tx_lcore\n");
+		CPE(nb_role[CONF_ROLE_RX] == 0 || nb_role[CONF_ROLE_LOOKUP] == 0 ||
+			nb_role[CONF_ROLE_TX] == 0,
+			"Pipeline mode needs rx_lcore, lookup_lcore and tx_lcore\n");
+	}
+
+	/**< A ring_pair port replies on the queue it received on (TX queue 0 in
+	  *  pipeline mode), so each generator on it needs its own queue pair:
+	  *  generators that shared a queue would take each other's replies. */
+	int i, j;
+	for(i = 0; i < conf->nb_ring_pairs; i ++) {
+		for(j = 0; j < 2; j ++) {
+			int port_id = conf->ring_pair[i][j], nb_gens = 0;
+			int max_gens = conf->pipeline ? 1 : conf->nb_srv_lcores;
+
+			for(lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id ++) {
+				if(conf->role[lcore_id] == CONF_ROLE_GEN &&
+					conf->gen_port[lcore_id] == port_id) {
+					nb_gens ++;
+				}
+			}
+
+			CPE2(nb_gens > max_gens,
+				"Ring pair port %d: use at most %d gen_lcores, one per queue\n",
+				port_id, max_gens);
+		}
+	}
+
+	return conf;
+}
+
+void conf_create_ring_pairs(struct l2fwd_conf *conf)
+{
+	int i, q;
+	int nb_queues = conf->nb_srv_lcores;
+
+	for(i = 0; i < conf->nb_ring_pairs; i ++) {
+		struct rte_ring *a_to_b[RTE_MAX_LCORE], *b_to_a[RTE_MAX_LCORE];
+		char name[32];
+
+		/**< Rings are multi-producer/consumer: tx_lcores share TX queue 0 */
+		for(q = 0; q < nb_queues; q ++) {
+			sprintf(name, "ring_pair_%d_ab_%d", i, q);
+			a_to_b[q] = rte_ring_create(name, CONF_RING_SIZE, 0, 0);
+			CPE1(a_to_b[q] == NULL, "Cannot create ring %s\n", name);
+
+			sprintf(name, "ring_pair_%d_ba_%d", i, q);
+			b_to_a[q] = rte_ring_create(name, CONF_RING_SIZE, 0, 0);
+			CPE1(b_to_a[q] == NULL, "Cannot create ring %s\n", name);
+		}
+
+		/**< What one port transmits, the other receives */
+		sprintf(name, "ring_pair_%d_a", i);
+		int port_a = rte_eth_from_rings(name, b_to_a, nb_queues,
+			a_to_b, nb_queues, 0);
+		sprintf(name, "ring_pair_%d_b", i);
+		int port_b = rte_eth_from_rings(name, a_to_b, nb_queues,
+			b_to_a, nb_queues, 0);
+
+		CPE2(port_a != conf->ring_pair[i][0] || port_b != conf->ring_pair[i][1],
+			"Ring pair created as ports %d and %d. Fix the config.\n",
+			port_a, port_b);
+
+		red_printf("Ring pair %d: ports %d <--> %d, %d queues\n",
+			i, port_a, port_b, nb_queues);
+	}
+}
@@ -0,0 +1,54 @@
+/**
+ * Testbed-independent configuration for the server (see README section 8).
+ * A config file replaces the xia-router port masks, MAC tables and lcore
+ * mapping, so the app can run on virtual devices (eth_ring, eth_pcap)
+ * with in-process traffic generator lcores instead of clients.
+ */
+
+/**< Lcore roles */
+#define CONF_ROLE_NONE 0
+#define CONF_ROLE_SRV 1
+#define CONF_ROLE_GEN 2
+#define CONF_ROLE_RX 3		/**< Pipeline mode (pipe.h) */
+#define CONF_ROLE_LOOKUP 4
+#define CONF_ROLE_TX 5
+
+/**< Number of descriptors in each ring of a ring_pair */
+#define CONF_RING_SIZE 1024
+
+#define CONF_MAX_LINE 256
+#define CONF_MAX_RING_PAIRS 4
+
+struct l2fwd_conf {
+	int srv_port_mask;		/**< Ports that server lcores RX from */
+	int gen_port_mask;		/**< Ports that generator lcores TX on */
+
+	/**< The L2 addresses written into packets sent on each port */
+	ULL src_mac[RTE_MAX_ETHPORTS];
+	ULL dst_mac[RTE_MAX_ETHPORTS];
+
+	int role[RTE_MAX_LCORE];		/**< CONF_ROLE_* */
+	int gen_port[RTE_MAX_LCORE];	/**< Port used by a generator lcore */
+	int nb_srv_lcores;		/**< srv_lcores or rx_lcores. Also the number of
+							  *  rings per ring_pair port. */
+	int pipeline;			/**< 1 if the server is split into rx_lcores,
+							  *  lookup_lcores and tx_lcores */
+
+	/**< Generator workload, the same for all generator lcores (gen.h) */
+	double gen_rate;		/**< Packets/s per generator lcore, 0 = no limit */
+	int gen_profile;		/**< GEN_PROFILE_* */
+	uint32_t gen_nb_flows;
+	double gen_flow_theta;
+	uint32_t gen_nb_keys;
+	double gen_key_theta;
+
+	/**< Port pairs to create with the ring PMD, wired back to back */
+	int ring_pair[CONF_MAX_RING_PAIRS][2];
+	int nb_ring_pairs;
+};
+
+/**< Parse a config file. Exits on errors. */
+struct l2fwd_conf *conf_load(const char *filename);
+
+/**< Create the ring_pair ports. Call after rte_eal_init(). */
+void conf_create_ring_pairs(struct l2fwd_conf *conf);
@@ -0,0 +1,72 @@
+# A function to echo in blue color
+function blue() {
+	es=`tput setaf 4`
+	ee=`tput sgr0`
+	echo "${es}$1${ee}"
+}
+
+# Binary search for the highest gen_rate at which the server keeps up (the
+# generators receive >= 99% of what they offer, and lose < 1% of their
+# tokens) and the worst generator's p99 latency is within an SLO.
+#	./gen-sweep.sh <conf file> <p99 SLO in us> [max Mpps per gen lcore]
+# Extra EAL args can be passed in $EAL_ARGS.
+
+if [ "$#" -lt 2 ]; then
+	echo "Usage: ./gen-sweep.sh <conf file> <p99 SLO in us> [max Mpps]"
+	exit
+fi
+
+conf_file="$1"
+slo_us=$2
+hi=${3:-16}			# Mpps per generator lcore
+lo=0
+num_steps=8
+run_time=8			# Seconds per rate. The first 2 stats lines are skipped.
+
+sweep_conf=/tmp/gen-sweep.conf
+sweep_out=/tmp/gen-sweep.out
+
+core_mask=`awk '$1 ~ /^(srv|gen|rx|lookup|tx)_lcore$/ {m += 2 ^ $2} \
+	END {printf("0x%x", m)}' "$conf_file"`
+
+blue "Compiling DPDK code"
+make || exit 1
+
+for step in `seq 1 $num_steps`; do
+	rate=`echo "$lo $hi" | awk '{printf("%.3f", ($1 + $2) / 2)}'`
+
+	grep -v "^gen_rate" "$conf_file" > $sweep_conf
+	echo "gen_rate `echo $rate | awk '{printf("%.0f", $1 * 1000000)}'`" >> $sweep_conf
+
+	sudo L2FWD_CONF=$sweep_conf L2FWD_STAGE=$L2FWD_STAGE timeout $run_time \
+		./build/l2fwd -c $core_mask -n 4 --no-pci $EAL_ARGS > $sweep_out 2>&1
+
+	# Sum the rates over generator lcores, and take the worst p99, over all
+	# stats lines except each lcore's first two (warmup)
+	result=`grep -a "^GEN lcore" $sweep_out | awk -v slo=$slo_us '
+		{
+			seen[$3] ++
+			if(seen[$3] > 2) {
+				offered += $5; rx += $9; lost += $11; n ++
+				if($15 > p99) p99 = $15
+			}
+		}
+		END {
+			if(n == 0 || offered == 0) { print "0 0 0 fail"; exit }
+			ok = (rx >= 0.99 * offered && lost < 0.01 * (offered + lost) &&
+				p99 <= slo) ? "ok" : "fail"
+			printf("%.3f %.3f %.2f %s\n", offered / n * 1e-6, rx / n * 1e-6,
+				p99, ok)
+		}'`
+
+	set -- $result
+	blue "Rate $rate Mpps/lcore: offered $1 Mpps, RX $2 Mpps, p99 $3 us: $4"
+
+	if [ "$4" == "ok" ]; then
+		lo=$rate
+	else
+		hi=$rate
+	fi
+done
+
+blue "Max sustainable rate at p99 <= $slo_us us: $lo Mpps per generator lcore"
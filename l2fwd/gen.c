@@ -0,0 +1,319 @@
+#include "main.h"
+#include <rte_hash_crc.h>
+#define MAX_GEN_TX_BURST 16
+#define MAX_GEN_RX_BURST 16
+
+static const char *gen_profile_names[GEN_NUM_PROFILES] = {
+	"ipv4", "ipv6", "key", "ndn", "snort"
+};
+
+/**< Shared by all generator lcores (gen_init()) */
+static char (*gen_ndn_names)[STAGE_NDN_MAX_NAME_LEN];
+static uint32_t gen_nb_ndn_names;
+static uint8_t (*gen_snort_payloads)[STAGE_AHO_PAYLOAD_LEN];
+
+int gen_profile_find(const char *name)
+{
+	int i;
+	for(i = 0; i < GEN_NUM_PROFILES; i ++) {
+		if(strcmp(name, gen_profile_names[i]) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void gen_zipf_init(struct gen_zipf *z, uint32_t n, double theta)
+{
+	uint32_t i;
+	assert(n > 0 && theta >= 0 && theta < 1);
+
+	z->n = n;
+	z->theta = theta;
+	if(theta == 0) {
+		return;		/**< Uniform: gen_zipf_next() needs only n */
+	}
+
+	z->zetan = 0;
+	for(i = 1; i <= n; i ++) {
+		z->zetan += 1 / pow((double) i, theta);
+	}
+
+	z->zeta2 = 1 + pow(0.5, theta);
+	z->alpha = 1 / (1 - theta);
+	z->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - z->zeta2 / z->zetan);
+}
+
+uint32_t gen_zipf_next(struct gen_zipf *z, uint64_t *seed)
+{
+	double u = fastrand(seed) / 4294967296.0;
+
+	if(z->theta == 0) {
+		return (uint32_t) (u * z->n);
+	}
+
+	double uz = u * z->zetan;
+	if(uz < 1) {
+		return 0;
+	}
+
+	if(uz < z->zeta2) {
+		return 1;
+	}
+
+	uint32_t ret = (uint32_t) (z->n * pow(z->eta * u - z->eta + 1, z->alpha));
+	return ret < z->n ? ret : z->n - 1;
+}
+
+void gen_init(struct l2fwd_conf *conf)
+{
+	uint32_t i;
+	int j;
+
+	if(conf->gen_profile == GEN_PROFILE_NDN) {
+		char line[STAGE_NDN_MAX_NAME_LEN + 2];
+		uint32_t max_names = conf->gen_nb_flows < GEN_NDN_MAX_NAMES ?
+			conf->gen_nb_flows : GEN_NDN_MAX_NAMES;
+
+		gen_ndn_names = malloc((size_t) max_names * STAGE_NDN_MAX_NAME_LEN);
+		assert(gen_ndn_names != NULL);
+
+		FILE *names_fp = fopen(STAGE_NDN_FIB_FILE, "r");
+		CPE(names_fp == NULL, "Cannot open " STAGE_NDN_FIB_FILE "\n");
+
+		while(gen_nb_ndn_names < max_names &&
+			fgets(line, sizeof(line), names_fp) != NULL) {
+			int len = strcspn(line, "\r\n");
+			CPE1(len >= STAGE_NDN_MAX_NAME_LEN, "NDN name %u is too long\n",
+				gen_nb_ndn_names);
+			if(len > 0) {
+				line[len] = 0;
+				memcpy(gen_ndn_names[gen_nb_ndn_names ++], line, len + 1);
+			}
+		}
+
+		fclose(names_fp);
+		CPE(gen_nb_ndn_names == 0, "No names in " STAGE_NDN_FIB_FILE "\n");
+		red_printf("Generator: %u NDN names for %u flows\n",
+			gen_nb_ndn_names, conf->gen_nb_flows);
+	}
+
+	if(conf->gen_profile == GEN_PROFILE_SNORT) {
+		uint64_t seed = 0xdeadbeef;
+
+		gen_snort_payloads = malloc(GEN_SNORT_NUM_PAYLOADS *
+			STAGE_AHO_PAYLOAD_LEN);
+		assert(gen_snort_payloads != NULL);
+
+		for(i = 0; i < GEN_SNORT_NUM_PAYLOADS; i ++) {
+			for(j = 0; j < STAGE_AHO_PAYLOAD_LEN; j ++) {
+				gen_snort_payloads[i][j] = fastrand(&seed) & 0xff;
+			}
+		}
+	}
+}
+
+/**
+ * Fill in the profile-specific part of a packet for a flow and a key.
+ * Returns the packet's length.
+ */
+static int gen_fill_payload(int profile, char *payload, uint32_t flow,
+	uint32_t key)
+{
+	const char *name;
+
+	switch(profile) {
+	case GEN_PROFILE_IPV4:
+		return GEN_PAYLOAD_OFFSET;	/**< lpm reads the flow's dst_addr */
+	case GEN_PROFILE_IPV6:
+		stage_flow_ipv6(flow, (uint8_t *) payload);
+		return GEN_PAYLOAD_OFFSET + 16;
+	case GEN_PROFILE_KEY:
+		*(uint64_t *) payload = stage_key_hash(key);
+		return GEN_PAYLOAD_OFFSET + 8;
+	case GEN_PROFILE_NDN:
+		name = gen_ndn_names[flow % gen_nb_ndn_names];
+		strcpy(payload, name);
+		return GEN_PAYLOAD_OFFSET + strlen(name) + 1;
+	case GEN_PROFILE_SNORT:
+		memcpy(payload, gen_snort_payloads[flow % GEN_SNORT_NUM_PAYLOADS],
+			STAGE_AHO_PAYLOAD_LEN);
+		return GEN_PAYLOAD_OFFSET + STAGE_AHO_PAYLOAD_LEN;
+	default:
+		assert(0);
+		return 0;
+	}
+}
+
+/**
+ * An in-process replacement for the clients, for runs with L2FWD_CONF. A
+ * generator lcore sends client-formatted packets (README section 4) on its
+ * port and measures the server's replies that come back on the same queue.
+ *
+ * With gen_rate, the generator is open-loop: a token bucket on the TSC
+ * releases one packet every 1 / gen_rate seconds, and latency is measured
+ * from the time a packet's token was created. Without it, bursts are sent
+ * back to back and a full TX ring is the back-pressure.
+ */
+void run_gen(struct rte_mempool **l2fwd_pktmbuf_pool)
+{
+	int i;
+
+	struct rte_mbuf *rx_pkts_burst[MAX_GEN_RX_BURST];
+	struct rte_mbuf *tx_pkts_burst[MAX_GEN_TX_BURST];
+
+	int lcore_id = rte_lcore_id();
+	int port_id = l2fwd_conf->gen_port[lcore_id];
+	int queue_id = topo_lcore_queue(lcore_id);
+	int profile = l2fwd_conf->gen_profile;
+	red_printf("Generator: lcore: %d, port: %d, queue: %d, profile: %s\n",
+		lcore_id, port_id, queue_id, gen_profile_names[profile]);
+
+	uint64_t rss_seed = 0xdeadbeef + lcore_id;
+
+	struct gen_zipf flows, keys;
+	gen_zipf_init(&flows, l2fwd_conf->gen_nb_flows, l2fwd_conf->gen_flow_theta);
+	gen_zipf_init(&keys, l2fwd_conf->gen_nb_keys, l2fwd_conf->gen_key_theta);
+
+	/**< Token bucket. due_tsc is the time at which the next token is made. */
+	double cycles_to_ns = (double) GHZ_CPS / rte_get_tsc_hz();
+	double cycles_per_pkt = l2fwd_conf->gen_rate > 0 ?
+		rte_get_tsc_hz() / l2fwd_conf->gen_rate : 0;
+	double due_tsc = rte_rdtsc();
+
+	LL print_cycles = (LL) (rte_get_tsc_hz() * (GEN_PRINT_US / 1000000.0));
+	LL prev_tsc = rte_rdtsc();
+
+	LL nb_offered = 0, nb_tx = 0, nb_rx = 0, nb_lost = 0;
+	struct ether_hdr *eth_hdr;
+	struct ipv4_hdr *ip_hdr;
+
+	struct hist *hist = malloc(sizeof(struct hist));
+	assert(hist != NULL);
+	hist_reset(hist);
+
+	/**< sizeof(ether_hdr) + sizeof(ipv4_hdr) is 34 --> 36 for 4 byte align */
+	int hdr_size = 36;
+
+	while (1) {
+		LL cur_tsc = rte_rdtsc();
+		int nb_due = MAX_GEN_TX_BURST;
+
+		if(cycles_per_pkt > 0) {
+			/**< Drop the tokens that are older than the bucket */
+			double oldest_tsc = cur_tsc - GEN_BUCKET_DEPTH * cycles_per_pkt;
+			if(due_tsc < oldest_tsc) {
+				LL nb_old = (LL) ((oldest_tsc - due_tsc) / cycles_per_pkt);
+				nb_lost += nb_old;
+				due_tsc += nb_old * cycles_per_pkt;
+			}
+
+			nb_due = due_tsc > cur_tsc ? 0 :
+				(int) ((cur_tsc - due_tsc) / cycles_per_pkt) + 1;
+			nb_due = nb_due < MAX_GEN_TX_BURST ? nb_due : MAX_GEN_TX_BURST;
+		}
+
+		for(i = 0; i < nb_due; i ++) {
+			uint32_t flow = gen_zipf_next(&flows, &rss_seed);
+			uint32_t key = 1 + gen_zipf_next(&keys, &rss_seed);
+
+			tx_pkts_burst[i] = rte_pktmbuf_alloc(l2fwd_pktmbuf_pool[lcore_id]);
+			CPE(tx_pkts_burst[i] == NULL, "tx_alloc failed\n");
+
+			char *data = rte_pktmbuf_mtod(tx_pkts_burst[i], char *);
+			eth_hdr = (struct ether_hdr *) data;
+			ip_hdr = (struct ipv4_hdr *) (data + sizeof(struct ether_hdr));
+
+			set_mac(&eth_hdr->s_addr.addr_bytes[0], l2fwd_conf->src_mac[port_id]);
+			set_mac(&eth_hdr->d_addr.addr_bytes[0], l2fwd_conf->dst_mac[port_id]);
+			eth_hdr->ether_type = htons(ETHER_TYPE_IPv4);
+
+			/**< Packets of a flow hash to the same RSS queue: RSS hashes
+			  *  both addresses */
+			ip_hdr->src_addr = rte_hash_crc_4byte(flow, 0xdeadbeef);
+			ip_hdr->dst_addr = rte_hash_crc_4byte(flow, 0);
+			ip_hdr->version_ihl = 0x40 | 0x05;
+
+			/**< Add global core-identifier, and the scheduled TX time */
+			int *magic = (int *) (data + hdr_size);
+			magic[0] = lcore_id;		/**< 36 -> 40 */
+
+			LL *clt_tsc = (LL *) (data + hdr_size + 4);
+			clt_tsc[0] = cycles_per_pkt > 0 ?
+				(LL) (due_tsc + i * cycles_per_pkt) : cur_tsc;	/**< 40 -> 48 */
+
+			int *req = (int *) (data + hdr_size + 20);
+			req[0] = key;	/**< 56 -> 60 */
+
+			int pkt_len = gen_fill_payload(profile,
+				data + GEN_PAYLOAD_OFFSET, flow, key);
+
+			tx_pkts_burst[i]->pkt.nb_segs = 1;
+			tx_pkts_burst[i]->pkt.pkt_len = pkt_len;
+			tx_pkts_burst[i]->pkt.data_len = pkt_len;
+		}
+
+		if(nb_due > 0) {
+			int nb_tx_new = rte_eth_tx_burst(port_id,
+				queue_id, tx_pkts_burst, nb_due);
+			nb_tx += nb_tx_new;
+			for(i = nb_tx_new; i < nb_due; i++) {
+				rte_pktmbuf_free(tx_pkts_burst[i]);
+			}
+
+			nb_offered += nb_due;
+			due_tsc += nb_due * cycles_per_pkt;
+		}
+
+		/**< RX drain */
+		while(1) {
+			int nb_rx_new = rte_eth_rx_burst(port_id,
+				queue_id, rx_pkts_burst, MAX_GEN_RX_BURST);
+			if(nb_rx_new == 0) {
+				break;
+			}
+
+			LL rx_tsc = rte_rdtsc();
+			nb_rx += nb_rx_new;
+			for(i = 0; i < nb_rx_new; i ++) {
+				char *data = rte_pktmbuf_mtod(rx_pkts_burst[i], char *);
+				int *magic = (int *) (data + hdr_size);
+				LL *clt_tsc = (LL *) (data + hdr_size + 4);
+
+				/**< On a NIC, RSS can put our replies on another generator's
+				  *  queue (ring_pair ports reply on the sending queue) */
+				if(magic[0] == lcore_id) {
+					hist_record(hist,
+						(ULL) (cycles_to_ns * (rx_tsc - clt_tsc[0])));
+				}
+
+				rte_pktmbuf_free(rx_pkts_burst[i]);
+			}
+		}
+
+		/**< gen-sweep.sh parses these lines. Rates are per second, lost
+		  *  counts the tokens that the generator was too slow to use, and
+		  *  latencies are in microseconds. */
+		if(unlikely(cur_tsc - prev_tsc >= print_cycles)) {
+			double seconds = (cycles_to_ns * (cur_tsc - prev_tsc)) / GHZ_CPS;
+			prev_tsc = cur_tsc;
+
+			printf("GEN lcore %d: offered %.0f tx %.0f rx %.0f lost %.0f "
+				"p50 %.2f p99 %.2f p999 %.2f max %.2f\n",
+				lcore_id, nb_offered / seconds, nb_tx / seconds,
+				nb_rx / seconds, nb_lost / seconds,
+				hist_percentile(hist, 50) / 1000.0,
+				hist_percentile(hist, 99) / 1000.0,
+				hist_percentile(hist, 99.9) / 1000.0,
+				hist->max / 1000.0);
+			fflush(stdout);
+
+			nb_offered = 0;
+			nb_tx = 0;
+			nb_rx = 0;
+			nb_lost = 0;
+			hist_reset(hist);
+		}
+	}
+}
@@ -0,0 +1,53 @@
+/**
+ * Workloads for the in-process generator (gen.c). Every packet has the
+ * client format of README section 4, with req[0] set to a key. A profile
+ * then fills in the input of one lookup stage, starting at byte
+ * GEN_PAYLOAD_OFFSET. Keys and flows are drawn from Zipf distributions:
+ * flows are 0 to gen_flows - 1 and keys are 1 to gen_keys, as key 0 is
+ * not in the stages' tables.
+ */
+
+/**< Profiles write their input after the client's request */
+#define GEN_PAYLOAD_OFFSET STAGE_PAYLOAD_OFFSET
+
+#define GEN_PROFILE_IPV4 0		/**< IPv4 dst address of the flow (lpm) */
+#define GEN_PROFILE_IPV6 1		/**< IPv6 dst address of the flow, in the payload (lpm6) */
+#define GEN_PROFILE_KEY 2		/**< 8-byte hash of the key (mica) */
+#define GEN_PROFILE_NDN 3		/**< Name of the flow, '\0' terminated (ndn) */
+#define GEN_PROFILE_SNORT 4		/**< Random payload of the flow (aho) */
+#define GEN_NUM_PROFILES 5
+#define GEN_PROFILE_DEFAULT GEN_PROFILE_KEY
+
+/**< The snort profile sends one of GEN_SNORT_NUM_PAYLOADS random payloads
+  *  of STAGE_AHO_PAYLOAD_LEN bytes */
+#define GEN_SNORT_NUM_PAYLOADS 1024
+
+/**< The ndn profile keeps at most this many names (the FIB has 10M) */
+#define GEN_NDN_MAX_NAMES M_16
+
+/**< Tokens that are not used within GEN_BUCKET_DEPTH packet times are lost:
+  *  the generator could not keep up with its rate. */
+#define GEN_BUCKET_DEPTH 64
+
+/**< Interval between stats lines */
+#define GEN_PRINT_US 1000000
+
+/**< Samples from {0, ..., n - 1} where i has probability ~ 1 / (i + 1)^theta,
+  *  with Gray et al.'s method ("Quickly generating billion-record synthetic
+  *  databases", SIGMOD '94). theta = 0 is uniform; theta must be < 1. */
+struct gen_zipf {
+	uint32_t n;
+	double theta;
+	double alpha, zetan, eta, zeta2;
+};
+
+void gen_zipf_init(struct gen_zipf *z, uint32_t n, double theta);
+uint32_t gen_zipf_next(struct gen_zipf *z, uint64_t *seed);
+
+/**< Returns the GEN_PROFILE_* with this name, or -1 */
+int gen_profile_find(const char *name);
+
+/**< Build the payloads that generator lcores share: flow i of the ndn
+  *  profile sends name i % n of the first n names of STAGE_NDN_FIB_FILE,
+  *  with n <= gen_flows. Call before launching the lcores. */
+void gen_init(struct l2fwd_conf *conf);
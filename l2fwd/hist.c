@@ -0,0 +1,88 @@
+/* Latency histograms, independent of DPDK */
+#include "util.h"
+#include "hist.h"
+
+static inline int hist_index(ULL value)
+{
+	if(value < HIST_SUB_COUNT) {
+		return (int) value;
+	}
+
+	/**< value >> shift is in [HIST_SUB_COUNT, 2 * HIST_SUB_COUNT) */
+	int shift = (63 - __builtin_clzll(value)) - HIST_SUB_BITS;
+	return (shift + 1) * HIST_SUB_COUNT +
+		(int) ((value >> shift) - HIST_SUB_COUNT);
+}
+
+/**< The largest value that maps to bucket index */
+static ULL hist_upper(int index)
+{
+	if(index < HIST_SUB_COUNT) {
+		return index;
+	}
+
+	int shift = index / HIST_SUB_COUNT - 1;
+	ULL top = (ULL) (index % HIST_SUB_COUNT + HIST_SUB_COUNT);
+	return ((top + 1) << shift) - 1;
+}
+
+void hist_reset(struct hist *h)
+{
+	memset(h, 0, sizeof(struct hist));
+}
+
+void hist_record(struct hist *h, ULL value)
+{
+	h->count[hist_index(value)] ++;
+	h->nb_samples ++;
+	if(value > h->max) {
+		h->max = value;
+	}
+}
+
+void hist_merge(struct hist *dst, const struct hist *src)
+{
+	int i;
+	for(i = 0; i < HIST_NUM_BUCKETS; i ++) {
+		dst->count[i] += src->count[i];
+	}
+
+	dst->nb_samples += src->nb_samples;
+	if(src->max > dst->max) {
+		dst->max = src->max;
+	}
+}
+
+ULL hist_percentile(const struct hist *h, double percentile)
+{
+	int i;
+	LL seen = 0;
+
+	if(h->nb_samples == 0) {
+		return 0;
+	}
+
+	/**< Rank of the sample we want, counting from 1 */
+	LL rank = (LL) ((percentile / 100) * h->nb_samples + 0.5);
+	rank = rank < 1 ? 1 : rank;
+
+	for(i = 0; i < HIST_NUM_BUCKETS; i ++) {
+		seen += h->count[i];
+		if(seen >= rank) {
+			ULL upper = hist_upper(i);
+			return upper < h->max ? upper : h->max;
+		}
+	}
+
+	return h->max;
+}
+
+void hist_dump(const struct hist *h, FILE *fp)
+{
+	int i;
+	for(i = 0; i < HIST_NUM_BUCKETS; i ++) {
+		if(h->count[i] != 0) {
+			fprintf(fp, "%llu %lld\n", hist_upper(i), h->count[i]);
+		}
+	}
+}
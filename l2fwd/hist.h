@@ -0,0 +1,31 @@
+/**
+ * Log-linear latency histograms, in the style of HdrHistogram. Values below
+ * 2^HIST_SUB_BITS get their own bucket. Above that, each power of 2 is split
+ * into 2^HIST_SUB_BITS equal buckets, so a recorded value is off by less
+ * than 1 / 2^HIST_SUB_BITS (about 3%). Recording is a few shifts and an
+ * increment, and histograms of different lcores can be merged by adding.
+ */
+#define HIST_SUB_BITS 5
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+
+/**< Enough buckets for any 64-bit value */
+#define HIST_NUM_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+
+struct hist {
+	LL count[HIST_NUM_BUCKETS];
+	LL nb_samples;
+	ULL max;
+};
+
+void hist_reset(struct hist *h);
+void hist_record(struct hist *h, ULL value);
+
+/**< dst += src */
+void hist_merge(struct hist *dst, const struct hist *src);
+
+/**< The smallest value v such that at least percentile% of the samples are
+  *  <= v, rounded up to its bucket's upper end. 0 for empty histograms. */
+ULL hist_percentile(const struct hist *h, double percentile);
+
+/**< Write one "<bucket upper end> <count>" line for each non-empty bucket */
+void hist_dump(const struct hist *h, FILE *fp);
@@ -1,6 +1,12 @@
 #include "main.h"
 int is_client = -1, client_id;
 
+const struct lookup_stage *srv_stage;
+void *srv_stage_tables[RTE_MAX_NUMA_NODES];
+
+struct l2fwd_conf *l2fwd_conf;
+int srv_port_mask = XIA_R2_PORT_MASK;
+
 static struct ether_addr l2fwd_ports_eth_addr[RTE_MAX_ETHPORTS]; /**< MACs */
 struct rte_mempool *l2fwd_pktmbuf_pool[RTE_MAX_LCORE];	/**< Per lcore mempools */
 
@@ -46,7 +52,27 @@ static const struct rte_eth_txconf tx_conf = {
 static int
 l2fwd_launch_one_lcore(__attribute__((unused)) void *dummy)
 {
-	if(is_client) {
+	if(l2fwd_conf != NULL) {
+		switch(l2fwd_conf->role[rte_lcore_id()]) {
+		case CONF_ROLE_SRV:
+			run_server();
+			break;
+		case CONF_ROLE_GEN:
+			run_gen(l2fwd_pktmbuf_pool);
+			break;
+		case CONF_ROLE_RX:
+			run_pipe_rx();
+			break;
+		case CONF_ROLE_LOOKUP:
+			run_pipe_lookup();
+			break;
+		case CONF_ROLE_TX:
+			run_pipe_tx();
+			break;
+		default:
+			return 0;
+		}
+	} else if(is_client) {
 		run_client(client_id, l2fwd_pktmbuf_pool);
 	} else {
 		run_server();
@@ -63,8 +89,14 @@ main(int argc, char **argv)
 	unsigned lcore_id;
 
 	/**< Do args parsing before EAL's args parsing.
-	  *  Do all data-structure hugepage allocations before EAL's init(). */
-	if(argc > 5) {
+	  *  Do all data-structure hugepage allocations before EAL's init().
+	  *  With L2FWD_CONF, there are no clients and EAL args may add --vdev. */
+	char *conf_file = getenv("L2FWD_CONF");
+	if(conf_file != NULL) {
+		is_client = 0;
+		l2fwd_conf = conf_load(conf_file);
+		srv_port_mask = l2fwd_conf->srv_port_mask;
+	} else if(argc > 5) {
 		is_client = 1;
 		client_id = atoi(argv[6]);
 	} else {
@@ -77,6 +109,10 @@ main(int argc, char **argv)
 	CPE(rte_pmd_init_all() < 0, "Cannot init pmd\n");
 	CPE(rte_eal_pci_probe() < 0, "Cannot probe PCI\n");
 
+	if(l2fwd_conf != NULL) {
+		conf_create_ring_pairs(l2fwd_conf);
+	}
+
 	nb_ports = rte_eth_dev_count();
 	nb_ports = nb_ports > RTE_MAX_ETHPORTS ? RTE_MAX_ETHPORTS : nb_ports;
 	CPE(nb_ports == 0, "No Ethernet ports - bye\n");
@@ -89,16 +125,31 @@ main(int argc, char **argv)
 			char pool_name[20];
 			sprintf(pool_name, "pool_%d", lcore_id);
 
+			int socket_id = rte_lcore_to_socket_id(lcore_id);
+
 			red_printf("Lcore %d is enabled. Creating mempool on socket %d\n",
-				lcore_id, LCORE_TO_SOCKET(lcore_id));
-			l2fwd_pktmbuf_pool[lcore_id] = mempool_init(pool_name,
-				LCORE_TO_SOCKET(lcore_id));
+				lcore_id, socket_id);
+			l2fwd_pktmbuf_pool[lcore_id] = mempool_init(pool_name, socket_id);
 			CPE(l2fwd_pktmbuf_pool[lcore_id] == NULL, "Cannot init mempool\n");
 		}
 	}
 
 	/* Initialise each port */
 	int portmask = is_client == 1 ? XIA_R0_PORT_MASK : XIA_R2_PORT_MASK;
+	if(l2fwd_conf != NULL) {
+		portmask = l2fwd_conf->srv_port_mask | l2fwd_conf->gen_port_mask;
+	}
+
+	/**< Map server lcores to the ports and queues on their socket */
+	if(!is_client) {
+		topo_init(srv_port_mask,
+			l2fwd_conf == NULL ? 0 : l2fwd_conf->gen_port_mask, nb_ports);
+	}
+
+	if(l2fwd_conf != NULL && l2fwd_conf->pipeline) {
+		pipe_init();
+	}
+
 	red_printf("\nInitializing ports\n");
 
 	for (port_id = 0; port_id < nb_ports; port_id ++) {
@@ -108,18 +159,20 @@ main(int argc, char **argv)
 
 		/**< xia-router0/1 use an IO-Hub for PCIe devices, so NICs don't have
 		  *  a NUMA-socket. */
-		int my_socket_id = is_client == 1 ?
-			get_socket_id_from_macaddr(port_id) :
-			rte_eth_dev_socket_id(port_id);
-
-		/**< XXX: Need to implement logic so that server lcores only access
-		  *  the ports on their socket. Until then, restrict to one socket */
-		if(!is_client) {
-			assert(my_socket_id == 0);
+		int my_socket_id, num_queues;
+		if(is_client) {
+			my_socket_id = get_socket_id_from_macaddr(port_id);
+			num_queues = 3;
+		} else {
+			my_socket_id = topo.port_socket[port_id];
+			num_queues = topo.port_nb_queues[port_id];
 		}
 
-		int num_queues = is_client == 1 ? 3 :
-			count_active_lcores_on_socket(my_socket_id);
+		if(num_queues == 0) {
+			red_printf("Port %d is on socket %d, which has no server lcores. "
+				"Skipping it.\n", port_id, my_socket_id);
+			continue;
+		}
 
 		printf("Initializing port %u on socket %d with %d queues \n", 
 			(unsigned) port_id, my_socket_id, num_queues);
@@ -135,7 +188,7 @@ main(int argc, char **argv)
 			if(is_client) {
 				my_lcore_id = client_port_queue_to_lcore(port_id, queue_id);
 			} else {
-				my_lcore_id = get_lcore_ranked_n(queue_id, my_socket_id);
+				my_lcore_id = topo_queue_to_lcore(port_id, queue_id);
 			}
 	
 			if(rte_lcore_is_enabled(my_lcore_id) == 0) {
@@ -172,6 +225,32 @@ main(int argc, char **argv)
 
 	check_all_ports_link_status(nb_ports, portmask);
 
+	/**< The server's lookup stage is chosen with the L2FWD_STAGE environment
+	  *  variable. Each socket with server (or lookup) lcores gets its own
+	  *  table. */
+	if(!is_client) {
+		const char *stage_name = getenv("L2FWD_STAGE");
+		if(stage_name == NULL) {
+			stage_name = STAGE_DEFAULT;
+		}
+
+		srv_stage = stage_find(stage_name);
+		CPE1(srv_stage == NULL, "Unknown lookup stage %s\n", stage_name);
+
+		int socket_id;
+		for(socket_id = 0; socket_id < RTE_MAX_NUMA_NODES; socket_id ++) {
+			if(topo.socket_needs_table[socket_id]) {
+				red_printf("\nInitializing lookup stage %s on socket %d\n",
+					srv_stage->name, socket_id);
+				srv_stage_tables[socket_id] = srv_stage->init(socket_id);
+			}
+		}
+	}
+
+	if(l2fwd_conf != NULL) {
+		gen_init(l2fwd_conf);
+	}
+
 	/**< Launch per-lcore init on every lcore */
 	rte_eal_mp_remote_launch(l2fwd_launch_one_lcore, NULL, CALL_MASTER);
 	RTE_LCORE_FOREACH_SLAVE(lcore_id) {
@@ -5,8 +5,10 @@
 #include <stdint.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <assert.h>
+#include <math.h>
 
 #include <rte_byteorder.h>
 #include <rte_common.h>
@@ -19,6 +21,13 @@
 
 #include "fpp.h"
 #include "util.h"
+#include "stage.h"
+#include "conf.h"
+#include "topo.h"
+#include "hist.h"
+#include "gen.h"
+#include "telem.h"
+#include "pipe.h"
 
 // sizeof(rte_mbuf) = 64, RTE_PKTMBUF_HEADROOM = 128
 #define MBUF_SIZE (2048 + sizeof(struct rte_mbuf) + RTE_PKTMBUF_HEADROOM)
@@ -54,14 +63,25 @@
 #define XIA_R0_PORT_MASK 0x3	// xge0,1
 #define XIA_R0_CPS 2270000000	// Client cycles per second
 
-#define XIA_R2_PORT_MASK 0xf	// xge0,1,2,3
+#define XIA_R2_PORT_MASK 0xff	// xge0,1,2,3 (socket 0), xge4,5,6,7 (socket 1)
 #define XIA_R2_CPS 2700000000	// Server cycles per second
 
-// On all xia-router* machines, even numbered lcores are on socket 0
-#define LCORE_TO_SOCKET(lcore) (lcore % 2)
-
-// Application-specific RX/TX burst size for the server
+// Application-specific RX burst size for the server. A burst is one batch
+// for the lookup stage (stage_input holds BATCH_SIZE packets).
 #define MAX_SRV_BURST 16
+#if MAX_SRV_BURST > BATCH_SIZE
+#error "MAX_SRV_BURST must not exceed BATCH_SIZE"
+#endif
+
+// The server's per-port TX batch size adapts between these powers of 2 to
+// the port's load (see the "stats" file for the per-packet cost of a batch).
+// Buffered packets are flushed every SRV_TX_DRAIN_US regardless.
+#define MIN_SRV_TX_BURST 8
+#define MAX_SRV_TX_BURST 64
+#define SRV_TX_DRAIN_US 100
+
+// Use the G-Opt server batch function
+#define SRV_USE_GOTO 0
 
 /**
  * Per-lcore, per-port statistics:
@@ -70,13 +90,17 @@
  * collected in the 0th element of this array.
  */
 struct lcore_port_info {
-	struct rte_mbuf *mbufs[MAX_SRV_BURST];
+	struct rte_mbuf *mbufs[MAX_SRV_TX_BURST];
 	int nb_buf;		/**< Number of packets buffered for TX on this port */
+	int tx_burst;	/**< Current TX batch size for this port */
+	int nb_enq;		/**< Packets buffered on this port in this drain period */
 	int nb_tx;		/**< Number of packets transmitted on this port */
 	int nb_rx;		/**< Number of packets received on this port */
 
 	int nb_tx_all_ports;	/**< Total packets transmitted on all ports */
 	int queue_id;	/**< Queue used by this lcore on this port */
+
+	struct telem_port telem;	/**< Never reset: published by telem_publish() */
 };
 
 /**< All packets forwarded to port #N need the same Ethernet header during TX.
@@ -84,6 +108,7 @@ struct lcore_port_info {
   *  makes the header-modification very cheap (3 integer copies). */
 struct mac_ints {
 	int chunk[3];
+	int port_id;	/**< The port that packets with this header leave on */
 };
 
 struct rte_mempool *mempool_init(char *name, int socket_id);
@@ -97,8 +122,35 @@ int get_socket_id_from_macaddr(int port_id);
 
 void check_all_ports_link_status(uint8_t port_num, int portmask);
 
+/**< The server's lookup stage, and its table on each socket */
+extern const struct lookup_stage *srv_stage;
+extern void *srv_stage_tables[RTE_MAX_NUMA_NODES];
+
+/**< The config used by run-vdev.sh runs, or NULL on the xia testbed */
+extern struct l2fwd_conf *l2fwd_conf;
+extern int srv_port_mask;		/**< Ports that the server RXes and TXes on */
+
 void run_server(void);
+
+/**< Server pieces that pipeline mode (pipe.c) reuses */
+void srv_mac_ints_init(struct mac_ints *mac_ints_arr, int port_mask);
+void process_batch_nogoto(struct rte_mbuf **pkts, int nb_pkts,
+	void *stage_table, const struct mac_ints *mac_ints_arr, int *tx_ports,
+	struct stage_stats *stage_stats);
+void process_batch_goto(struct rte_mbuf **pkts, int nb_pkts,
+	void *stage_table, const struct mac_ints *mac_ints_arr, int *tx_ports,
+	struct stage_stats *stage_stats);
+void send_packet(struct rte_mbuf *pkt, int port_id,
+	struct lcore_port_info *lp_info);
+void drain_ports(int *port_arr, int num_active_ports,
+	struct lcore_port_info *lp_info);
+
+/**< Create this lcore's telemetry segment, and update it (telem.h) */
+struct telem *telem_init(int lcore_id, int queue_id, int port_mask);
+void telem_publish(struct telem *t, struct lcore_port_info *lp_info,
+	struct stage_stats *stage_tot, struct stage_stats *stage_stats);
 void run_client(int client_id, struct rte_mempool **l2fwd_pktmbuf_pool);
+void run_gen(struct rte_mempool **l2fwd_pktmbuf_pool);
 
 void micro_sleep(double us, double cycles_to_ns_fac);
 
@@ -0,0 +1,385 @@
+/* Pipeline mode for the server: see pipe.h */
+#include "main.h"
+#include <rte_ring.h>
+
+struct pipeline pipeline;
+
+static struct rte_ring *pipe_ring_create(const char *type, int i, int j,
+	int consumer_lcore)
+{
+	char name[32];
+	sprintf(name, "pipe_%s_%d_%d", type, i, j);
+
+	/**< On the consumer's socket: the producer's stores are remote anyway */
+	struct rte_ring *ring = rte_ring_create(name, PIPE_RING_SIZE,
+		rte_lcore_to_socket_id(consumer_lcore), RING_F_SP_ENQ | RING_F_SC_DEQ);
+	CPE1(ring == NULL, "Cannot create ring %s\n", name);
+	return ring;
+}
+
+void pipe_init(void)
+{
+	int lcore_id, i, j, port_id;
+	struct pipeline *p = &pipeline;
+
+	memset(p, 0, sizeof(struct pipeline));
+
+	for(lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id ++) {
+		int *nb;
+		int *arr;
+
+		switch(l2fwd_conf->role[lcore_id]) {
+		case CONF_ROLE_RX:
+			arr = p->rx_lcores;
+			nb = &p->nb_rx_lcores;
+			break;
+		case CONF_ROLE_LOOKUP:
+			arr = p->lookup_lcores;
+			nb = &p->nb_lookup_lcores;
+			break;
+		case CONF_ROLE_TX:
+			arr = p->tx_lcores;
+			nb = &p->nb_tx_lcores;
+			break;
+		default:
+			continue;
+		}
+
+		CPE1(*nb == PIPE_MAX_LCORES, "Too many lcores in a pipeline role "
+			"(max %d)\n", PIPE_MAX_LCORES);
+		p->lcore_index[lcore_id] = *nb;
+		arr[(*nb) ++] = lcore_id;
+	}
+
+	for(i = 0; i < p->nb_rx_lcores; i ++) {
+		for(j = 0; j < p->nb_lookup_lcores; j ++) {
+			p->rx_to_lookup[i][j] = pipe_ring_create("rx_lookup", i, j,
+				p->lookup_lcores[j]);
+		}
+	}
+
+	for(i = 0; i < p->nb_lookup_lcores; i ++) {
+		for(j = 0; j < p->nb_tx_lcores; j ++) {
+			p->lookup_to_tx[i][j] = pipe_ring_create("lookup_tx", i, j,
+				p->tx_lcores[j]);
+		}
+	}
+
+	/**< Deal the server ports to the tx_lcores */
+	i = 0;
+	for(port_id = 0; port_id < RTE_MAX_ETHPORTS; port_id ++) {
+		if(ISSET(l2fwd_conf->srv_port_mask, port_id)) {
+			p->port_tx[port_id] = i % p->nb_tx_lcores;
+			red_printf("Pipeline: port %d is sent on by tx_lcore %d\n",
+				port_id, p->tx_lcores[i % p->nb_tx_lcores]);
+			i ++;
+		}
+	}
+
+	if(p->nb_tx_lcores > i) {
+		red_printf("Pipeline: %d tx_lcores for %d server ports. "
+			"Some tx_lcores will be idle.\n", p->nb_tx_lcores, i);
+	}
+
+	red_printf("Pipeline: %d rx_lcores --> %d lookup_lcores --> %d tx_lcores\n",
+		p->nb_rx_lcores, p->nb_lookup_lcores, p->nb_tx_lcores);
+}
+
+/**< Publish telemetry and print stats. Returns 1 if stats were printed. */
+static int pipe_stats(const char *role, struct telem *telem,
+	struct lcore_port_info *lp_info, struct stage_stats *stage_tot,
+	struct stage_stats *stage_stats, LL nb_pkts, LL nb_drop,
+	LL *telem_tsc, LL *print_tsc, LL cur_tsc)
+{
+	LL tsc_hz = rte_get_tsc_hz();
+
+	if(cur_tsc - *telem_tsc >= tsc_hz * TELEM_PUBLISH_US / 1000000) {
+		telem_publish(telem, lp_info, stage_tot, stage_stats);
+		*telem_tsc = cur_tsc;
+	}
+
+	if(cur_tsc - *print_tsc < tsc_hz * PIPE_PRINT_US / 1000000) {
+		return 0;
+	}
+
+	double seconds = (double) (cur_tsc - *print_tsc) / tsc_hz;
+	*print_tsc = cur_tsc;
+
+	red_printf("PIPE %s lcore %d: %.3f Mpps, ring full drops %.3f Mpps\n",
+		role, rte_lcore_id(), nb_pkts / seconds / 1000000,
+		nb_drop / seconds / 1000000);
+	return 1;
+}
+
+void run_pipe_rx(void)
+{
+	int i, l;
+	int lcore_id = rte_lcore_id();
+	int socket_id = rte_lcore_to_socket_id(lcore_id);
+	int queue_id = topo_lcore_queue(lcore_id);
+	int me = pipeline.lcore_index[lcore_id];
+	int port_mask = topo.socket_port_mask[socket_id];
+
+	if(port_mask == 0) {
+		red_printf("RX lcore %d: no server ports on socket %d. Exiting.\n",
+			lcore_id, socket_id);
+		return;
+	}
+
+	printf("RX lcore %d, socket %d. Queue Id = %d, ports = 0x%x\n",
+		lcore_id, socket_id, queue_id, port_mask);
+
+	int num_active_ports = bitcount(port_mask);
+	int *port_arr = get_active_bits(port_mask);
+
+	/**< Only for telemetry */
+	struct lcore_port_info lp_info[RTE_MAX_ETHPORTS];
+	memset(lp_info, 0, RTE_MAX_ETHPORTS * sizeof(struct lcore_port_info));
+	struct stage_stats stage_tot;
+	memset(&stage_tot, 0, sizeof(struct stage_stats));
+
+	struct telem *telem = telem_init(lcore_id, queue_id, port_mask);
+	LL telem_tsc = rte_rdtsc(), print_tsc = telem_tsc;
+	LL nb_pkts = 0, nb_drop = 0;
+
+	struct rte_mbuf *rx_pkts_burst[MAX_SRV_BURST];
+	int port_index = 0;
+
+	/**< Packets for each lookup_lcore */
+	struct rte_mbuf *lookup_pkts[PIPE_MAX_LCORES][MAX_SRV_BURST];
+	int nb_lookup_pkts[PIPE_MAX_LCORES];
+	memset(nb_lookup_pkts, 0, sizeof(nb_lookup_pkts));
+
+	while(1) {
+		int port_id = port_arr[port_index];
+		int nb_rx_new = 0, tries = 0;
+
+		LL cur_tsc = rte_rdtsc();
+		if(pipe_stats("RX", telem, lp_info, &stage_tot, &stage_tot,
+			nb_pkts, nb_drop, &telem_tsc, &print_tsc, cur_tsc)) {
+			nb_pkts = 0;
+			nb_drop = 0;
+		}
+
+		while(nb_rx_new < MAX_SRV_BURST && tries < 5) {
+			nb_rx_new += rte_eth_rx_burst(port_id, queue_id,
+				&rx_pkts_burst[nb_rx_new], MAX_SRV_BURST - nb_rx_new);
+			tries ++;
+		}
+
+		lp_info[port_id].telem.rx_burst[telem_burst_bucket(nb_rx_new)] ++;
+		port_index = (port_index + 1) < num_active_ports ? port_index + 1 : 0;
+
+		if(nb_rx_new == 0) {
+			continue;
+		}
+
+		lp_info[port_id].telem.nb_rx += nb_rx_new;
+		nb_pkts += nb_rx_new;
+
+		/**< A flow goes to one lookup_lcore, which keeps its packets in
+		  *  order. The generator's IP src_addr is a hash of the flow. */
+		for(i = 0; i < nb_rx_new; i ++) {
+			rte_prefetch0(rte_pktmbuf_mtod(rx_pkts_burst[i], char *) +
+				sizeof(struct ether_hdr));
+		}
+
+		for(i = 0; i < nb_rx_new; i ++) {
+			struct ipv4_hdr *ip_hdr = (struct ipv4_hdr *)
+				(rte_pktmbuf_mtod(rx_pkts_burst[i], char *) +
+				sizeof(struct ether_hdr));
+			l = ip_hdr->src_addr % pipeline.nb_lookup_lcores;
+			lookup_pkts[l][nb_lookup_pkts[l] ++] = rx_pkts_burst[i];
+		}
+
+		for(l = 0; l < pipeline.nb_lookup_lcores; l ++) {
+			if(nb_lookup_pkts[l] == 0) {
+				continue;
+			}
+
+			int nb_enq = rte_ring_enqueue_burst(pipeline.rx_to_lookup[me][l],
+				(void **) lookup_pkts[l], nb_lookup_pkts[l]);
+			for(i = nb_enq; i < nb_lookup_pkts[l]; i ++) {
+				rte_pktmbuf_free(lookup_pkts[l][i]);
+			}
+
+			nb_drop += nb_lookup_pkts[l] - nb_enq;
+			nb_lookup_pkts[l] = 0;
+		}
+	}
+}
+
+void run_pipe_lookup(void)
+{
+	int i, t;
+	int lcore_id = rte_lcore_id();
+	int socket_id = rte_lcore_to_socket_id(lcore_id);
+	int me = pipeline.lcore_index[lcore_id];
+
+	void *stage_table = srv_stage_tables[socket_id];
+
+	/**< Lookup results map to all server ports, not just this socket's */
+	struct mac_ints mac_ints_arr[4];
+	srv_mac_ints_init(mac_ints_arr, l2fwd_conf->srv_port_mask);
+
+	printf("Lookup lcore %d, socket %d\n", lcore_id, socket_id);
+
+	struct lcore_port_info lp_info[RTE_MAX_ETHPORTS];
+	memset(lp_info, 0, RTE_MAX_ETHPORTS * sizeof(struct lcore_port_info));
+	struct stage_stats stage_stats, stage_tot;
+	memset(&stage_stats, 0, sizeof(struct stage_stats));
+	memset(&stage_tot, 0, sizeof(struct stage_stats));
+
+	/**< Per-port telemetry: nb_rx counts the packets from a port, nb_tx the
+	  *  packets handed to its tx_lcore and nb_drop those lost on a full ring */
+	struct telem *telem = telem_init(lcore_id, 0, l2fwd_conf->srv_port_mask);
+	LL telem_tsc = rte_rdtsc(), print_tsc = telem_tsc;
+	LL nb_pkts = 0, nb_drop = 0;
+
+	struct rte_mbuf *pkts[BATCH_SIZE];
+	int tx_ports[BATCH_SIZE];
+
+	/**< Packets for each tx_lcore */
+	struct rte_mbuf *tx_pkts[PIPE_MAX_LCORES][BATCH_SIZE];
+	int nb_tx_pkts[PIPE_MAX_LCORES];
+	memset(nb_tx_pkts, 0, sizeof(nb_tx_pkts));
+
+	int rx_index = 0;
+
+	while(1) {
+		LL cur_tsc = rte_rdtsc();
+		if(pipe_stats("LOOKUP", telem, lp_info, &stage_tot, &stage_stats,
+			nb_pkts, nb_drop, &telem_tsc, &print_tsc, cur_tsc)) {
+			stage_stats_add(&stage_tot, &stage_stats);
+			stage_print_stats(srv_stage, &stage_stats, lcore_id);
+			nb_pkts = 0;
+			nb_drop = 0;
+		}
+
+		struct rte_ring *ring = pipeline.rx_to_lookup[rx_index][me];
+		rx_index = (rx_index + 1) < pipeline.nb_rx_lcores ? rx_index + 1 : 0;
+
+		int nb_pkts_new = rte_ring_dequeue_burst(ring, (void **) pkts,
+			BATCH_SIZE);
+		if(nb_pkts_new == 0) {
+			continue;
+		}
+
+		nb_pkts += nb_pkts_new;
+		for(i = 0; i < nb_pkts_new; i ++) {
+			lp_info[pkts[i]->pkt.in_port].telem.nb_rx ++;
+		}
+
+		LL batch_tsc = rte_rdtsc();
+		if(SRV_USE_GOTO) {
+			process_batch_goto(pkts, nb_pkts_new, stage_table,
+				mac_ints_arr, tx_ports, &stage_stats);
+		} else {
+			process_batch_nogoto(pkts, nb_pkts_new, stage_table,
+				mac_ints_arr, tx_ports, &stage_stats);
+		}
+
+		stage_stats.nb_cycles += rte_rdtsc() - batch_tsc;
+
+		/**< The output port travels in the mbuf's in_port field, which is
+		  *  not used after RX */
+		for(i = 0; i < nb_pkts_new; i ++) {
+			t = pipeline.port_tx[tx_ports[i]];
+			pkts[i]->pkt.in_port = tx_ports[i];
+			tx_pkts[t][nb_tx_pkts[t] ++] = pkts[i];
+		}
+
+		for(t = 0; t < pipeline.nb_tx_lcores; t ++) {
+			if(nb_tx_pkts[t] == 0) {
+				continue;
+			}
+
+			int nb_enq = rte_ring_enqueue_burst(pipeline.lookup_to_tx[me][t],
+				(void **) tx_pkts[t], nb_tx_pkts[t]);
+			for(i = 0; i < nb_tx_pkts[t]; i ++) {
+				struct telem_port *tp = &lp_info[tx_pkts[t][i]->pkt.in_port].telem;
+				if(i < nb_enq) {
+					tp->nb_tx ++;
+				} else {
+					tp->nb_drop ++;
+					rte_pktmbuf_free(tx_pkts[t][i]);
+				}
+			}
+
+			nb_drop += nb_tx_pkts[t] - nb_enq;
+			nb_tx_pkts[t] = 0;
+		}
+	}
+}
+
+void run_pipe_tx(void)
+{
+	int i, port_id;
+	int lcore_id = rte_lcore_id();
+	int me = pipeline.lcore_index[lcore_id];
+
+	int port_mask = 0;
+	for(port_id = 0; port_id < RTE_MAX_ETHPORTS; port_id ++) {
+		if(ISSET(l2fwd_conf->srv_port_mask, port_id) &&
+			pipeline.port_tx[port_id] == me) {
+			port_mask |= (1 << port_id);
+		}
+	}
+
+	if(port_mask == 0) {
+		red_printf("TX lcore %d: no ports to send on. Exiting.\n", lcore_id);
+		return;
+	}
+
+	printf("TX lcore %d, socket %d. Queue Id = 0, ports = 0x%x\n",
+		lcore_id, rte_lcore_to_socket_id(lcore_id), port_mask);
+
+	int num_active_ports = bitcount(port_mask);
+	int *port_arr = get_active_bits(port_mask);
+
+	struct lcore_port_info lp_info[RTE_MAX_ETHPORTS];
+	memset(lp_info, 0, RTE_MAX_ETHPORTS * sizeof(struct lcore_port_info));
+	for(i = 0; i < RTE_MAX_ETHPORTS; i ++) {
+		lp_info[i].queue_id = 0;
+		lp_info[i].tx_burst = MAX_SRV_BURST;
+	}
+
+	struct stage_stats stage_tot;
+	memset(&stage_tot, 0, sizeof(struct stage_stats));
+
+	struct telem *telem = telem_init(lcore_id, 0, port_mask);
+	LL telem_tsc = rte_rdtsc(), print_tsc = telem_tsc;
+	LL nb_pkts = 0;
+
+	LL drain_cycles = (LL) rte_get_tsc_hz() * SRV_TX_DRAIN_US / 1000000;
+	LL drain_tsc = rte_rdtsc();
+
+	struct rte_mbuf *pkts[BATCH_SIZE];
+	int lookup_index = 0;
+
+	while(1) {
+		LL cur_tsc = rte_rdtsc();
+		if(unlikely(cur_tsc - drain_tsc >= drain_cycles)) {
+			drain_ports(port_arr, num_active_ports, lp_info);
+			drain_tsc = cur_tsc;
+		}
+
+		if(pipe_stats("TX", telem, lp_info, &stage_tot, &stage_tot,
+			nb_pkts, 0, &telem_tsc, &print_tsc, cur_tsc)) {
+			nb_pkts = 0;
+		}
+
+		struct rte_ring *ring = pipeline.lookup_to_tx[lookup_index][me];
+		lookup_index = (lookup_index + 1) < pipeline.nb_lookup_lcores ?
+			lookup_index + 1 : 0;
+
+		int nb_pkts_new = rte_ring_dequeue_burst(ring, (void **) pkts,
+			BATCH_SIZE);
+
+		for(i = 0; i < nb_pkts_new; i ++) {
+			send_packet(pkts[i], pkts[i]->pkt.in_port, lp_info);
+		}
+
+		nb_pkts += nb_pkts_new;
+	}
+}
@@ -0,0 +1,49 @@
+/**
+ * Pipeline mode for the server (README section 10). Instead of running RX,
+ * lookup and TX to completion on every server lcore:
+ *	rx_lcores poll the server ports of their socket (like server lcores, see
+ *		topo.h) and hand each packet to a lookup_lcore by flow hash;
+ *	lookup_lcores run the lookup stage and header rewrite with the server's
+ *		batch function, and hand each packet to the tx_lcore of its port;
+ *	tx_lcores buffer and transmit, with the server's adaptive TX batching.
+ * Every pair of adjacent lcores has its own single-producer/single-consumer
+ * rte_ring, and packets cross them in batches of up to BATCH_SIZE, the
+ * G-Opt width. Placement comes from the config's rx_lcore, lookup_lcore and
+ * tx_lcore lines.
+ */
+struct rte_ring;
+
+#define PIPE_MAX_LCORES 16		/**< Per role */
+#define PIPE_RING_SIZE 4096
+
+/**< Interval between stats lines */
+#define PIPE_PRINT_US 1000000
+
+struct pipeline {
+	int rx_lcores[PIPE_MAX_LCORES];
+	int nb_rx_lcores;
+	int lookup_lcores[PIPE_MAX_LCORES];
+	int nb_lookup_lcores;
+	int tx_lcores[PIPE_MAX_LCORES];
+	int nb_tx_lcores;
+
+	int lcore_index[RTE_MAX_LCORE];		/**< Index in the lcore's role array */
+
+	/**< rx_to_lookup[i][j] is written by rx_lcores[i] and read by
+	  *  lookup_lcores[j]. Same for lookup_to_tx. */
+	struct rte_ring *rx_to_lookup[PIPE_MAX_LCORES][PIPE_MAX_LCORES];
+	struct rte_ring *lookup_to_tx[PIPE_MAX_LCORES][PIPE_MAX_LCORES];
+
+	/**< Index of the tx_lcore that sends on a server port. A port has one
+	  *  tx_lcore, which uses TX queue 0: rx_lcores do not TX. */
+	int port_tx[RTE_MAX_ETHPORTS];
+};
+
+extern struct pipeline pipeline;
+
+/**< Assign lcores and ports, and create the rings. Call after topo_init(). */
+void pipe_init(void);
+
+void run_pipe_rx(void);
+void run_pipe_lookup(void);
+void run_pipe_tx(void);
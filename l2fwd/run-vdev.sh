@@ -0,0 +1,28 @@
+# A function to echo in blue color
+function blue() {
+	es=`tput setaf 4`
+	ee=`tput sgr0`
+	echo "${es}$1${ee}"
+}
+
+# Run the server and the in-process generators on virtual devices, without
+# NICs or clients. Extra args (e.g., a --vdev eth_pcap0,... device) are
+# passed to EAL. Run ./rm-huge.sh first if EAL cannot get its hugepages.
+#	./run-vdev.sh [conf file] [EAL args]
+
+conf_file="vdev.conf"
+if [ "$#" -ge 1 ]; then
+	conf_file="$1"
+	shift
+fi
+
+# One lcore per *_lcore line
+core_mask=`awk '$1 ~ /^(srv|gen|rx|lookup|tx)_lcore$/ {m += 2 ^ $2} \
+	END {printf("0x%x", m)}' "$conf_file"`
+
+blue "Compiling DPDK code"
+make || exit 1
+
+blue "Running server and generators with lcore mask $core_mask"
+sudo L2FWD_CONF="$conf_file" L2FWD_STAGE="$L2FWD_STAGE" \
+	./build/l2fwd -c $core_mask -n 4 --no-pci "$@"
@@ -10,6 +10,35 @@ LL src_mac_arr[8] = {0x6c10bb211b00, 0x6d10bb211b00, 0x64d2bd211b00, 0x65d2bd211
 LL dst_mac_arr[8] = {0x36d3bd211b00, 0x37d3bd211b00, 0x44d7a3211b00, 0x45d7a3211b00,
 					 0xa8d6a3211b00, 0xa9d6a3211b00, 0x0ad7a3211b00, 0x0bd7a3211b00};
 
+/**
+ * Transmit all packets buffered for a port, and free the ones that the NIC
+ * does not take.
+ */
+void flush_port(int port_id, struct lcore_port_info *lp_info)
+{
+	int i;
+	int nb_buf = lp_info[port_id].nb_buf;
+	int queue_id = lp_info[port_id].queue_id;
+
+	int nb_tx_new = rte_eth_tx_burst(port_id, queue_id, 
+		lp_info[port_id].mbufs, nb_buf);
+
+	/**< Free unsent packets */
+	for(i = nb_tx_new; i < nb_buf; i ++) {
+		rte_pktmbuf_free(lp_info[port_id].mbufs[i]);
+	}
+
+	lp_info[port_id].nb_tx += nb_tx_new;
+	lp_info[0].nb_tx_all_ports += nb_tx_new;
+
+	struct telem_port *telem = &lp_info[port_id].telem;
+	telem->nb_tx += nb_tx_new;
+	telem->nb_drop += nb_buf - nb_tx_new;
+	telem->tx_burst[telem_burst_bucket(nb_buf)] ++;
+	
+	lp_info[port_id].nb_buf = 0;
+}
+
 /**
  * Enque a packet for transmission on a port. The per-port rx/tx/buffering 
  * statistics, and the queue to use for transmission are kept in the 
@@ -18,9 +47,7 @@ LL dst_mac_arr[8] = {0x36d3bd211b00, 0x37d3bd211b00, 0x44d7a3211b00, 0x45d7a3211
 void send_packet(struct rte_mbuf *pkt, int port_id, 
 	struct lcore_port_info *lp_info)
 {
-	int i;
-
-	if(unlikely(!ISSET(XIA_R2_PORT_MASK, port_id))) {
+	if(unlikely(!ISSET(srv_port_mask, port_id))) {
 		red_printf("TX on invalid port!. Exiting.\n");
 		exit(-1);
 	}
@@ -28,52 +55,71 @@ void send_packet(struct rte_mbuf *pkt, int port_id,
 	int tot_buffered = lp_info[port_id].nb_buf;
 
 	lp_info[port_id].mbufs[tot_buffered] = pkt;
-	tot_buffered ++;
+	lp_info[port_id].nb_buf = tot_buffered + 1;
+	lp_info[port_id].nb_enq ++;
 
 	/**< TX when a sufficient number of packets are buffered */
-	if(unlikely(tot_buffered == MAX_SRV_BURST)) {
-		int queue_id = lp_info[port_id].queue_id;
-		int nb_tx_new = rte_eth_tx_burst(port_id, queue_id, 
-			lp_info[port_id].mbufs, MAX_SRV_BURST);
-
-		/**< Free unsent packets */
-		for(i = nb_tx_new; i < MAX_SRV_BURST; i ++) {
-			rte_pktmbuf_free(lp_info[port_id].mbufs[i]);
+	if(unlikely(tot_buffered + 1 >= lp_info[port_id].tx_burst)) {
+		flush_port(port_id, lp_info);
+	}
+}
+
+/**
+ * Called every SRV_TX_DRAIN_US. Flush the packets that are still buffered
+ * so that they do not wait for more traffic, and adapt each port's TX batch
+ * size to the load seen in the last period: a port that buffered several
+ * full batches can afford bigger ones, and a port that needed the timer to
+ * flush should use smaller ones.
+ */
+void drain_ports(int *port_arr, int num_active_ports,
+	struct lcore_port_info *lp_info)
+{
+	int i;
+
+	for(i = 0; i < num_active_ports; i ++) {
+		int port_id = port_arr[i];
+		struct lcore_port_info *lp = &lp_info[port_id];
+
+		if(lp->nb_enq >= 4 * lp->tx_burst && lp->tx_burst < MAX_SRV_TX_BURST) {
+			lp->tx_burst *= 2;
+		} else if(lp->nb_enq < lp->tx_burst && lp->tx_burst > MIN_SRV_TX_BURST) {
+			lp->tx_burst /= 2;
 		}
 
-		lp_info[port_id].nb_tx += nb_tx_new;
-		lp_info[0].nb_tx_all_ports += nb_tx_new;
-		
-		lp_info[port_id].nb_buf = 0;
-		
-	} else {
-		lp_info[port_id].nb_buf = tot_buffered;
+		lp->nb_enq = 0;
+
+		if(lp->nb_buf > 0) {
+			flush_port(port_id, lp_info);
+		}
 	}
 }
 
+/**
+ * Route a burst with the lookup stage and rewrite the Ethernet headers. The
+ * caller sends pkts[i] on tx_ports[i]: directly (run_server()) or through a
+ * TX lcore (pipeline mode, pipe.c).
+ */
 void process_batch_nogoto(struct rte_mbuf **pkts, int nb_pkts,
-	struct lcore_port_info *lp_info,
-	const struct mac_ints *mac_ints_arr)
+	void *stage_table, const struct mac_ints *mac_ints_arr, int *tx_ports,
+	struct stage_stats *stage_stats)
 {
 	int batch_index = 0;
+	int dst_ports[BATCH_SIZE];
+	struct stage_input in;
 
-	/**< sizeof(ether_hdr) + sizeof(ipv4_hdr) is 34 --> 36 for 4 byte align */
-	int hdr_size = 36;
+	assert(nb_pkts > 0 && nb_pkts <= BATCH_SIZE);
 
-	foreach(batch_index, nb_pkts) {
-		struct ether_hdr *eth_hdr;
-
-		if(batch_index != nb_pkts - 1) {
-			rte_prefetch0(pkts[batch_index + 1]->pkt.data);
-		}
+	/**< Route the burst with the lookup stage */
+	stage_input_init(srv_stage, &in, pkts, nb_pkts);
+	stage_process_batch(srv_stage, stage_table, &in, dst_ports, stage_stats);
 
-		eth_hdr = (struct ether_hdr *) pkts[batch_index]->pkt.data;
+	foreach(batch_index, nb_pkts) {
+		struct ether_hdr *eth_hdr = (struct ether_hdr *) in.base[batch_index];
 
-		/**< Extract the client's request and compute response */
-		int *req = (int *) (rte_pktmbuf_mtod(pkts[batch_index], char *) +
-			hdr_size + 20);
+		/**< The client's request, in place */
+		int *req = (int *) (in.base[batch_index] + STAGE_REQ_OFFSET);
 
-		int dst_port = req[0] & 3;
+		int dst_port = dst_ports[batch_index];
 
 		/**< TX boilerplate: use the computed next_hop for L2 src and dst. */
 		int *mac_ints_dst = (int *) eth_hdr;
@@ -84,58 +130,194 @@ void process_batch_nogoto(struct rte_mbuf **pkts, int nb_pkts,
 		/**< Garble dst MAC to reduce RX load on clients */
 		eth_hdr->d_addr.addr_bytes[0] += ((req[0] >> 8) & 0xff);
 
-		/**< Send out the packet based on the value of resp */
-		send_packet(pkts[batch_index], dst_port, lp_info);
+		tx_ports[batch_index] = mac_ints_arr[dst_port].port_id;
 	}
 }
 
-void run_server(void)
+/**
+ * G-Opt version of process_batch_nogoto. The packet header and key misses,
+ * the lookup stage's table misses and the MAC rewrite of up to BATCH_SIZE
+ * packets are interleaved: the first switch is on the packet. Partial
+ * bursts are interleaved too: only the first nb_pkts slots are used.
+ */
+void process_batch_goto(struct rte_mbuf **pkts, int nb_pkts,
+	void *stage_table, const struct mac_ints *mac_ints_arr, int *tx_ports,
+	struct stage_stats *stage_stats)
+{
+	struct ether_hdr *eth_hdr[BATCH_SIZE];
+	int *req[BATCH_SIZE];
+	struct stage_ctx ctx[BATCH_SIZE];
+	const void *addr[BATCH_SIZE];
+	int dst_port[BATCH_SIZE];
+	struct stage_input in;
+
+	int I = 0;			// batch index
+	void *batch_rips[BATCH_SIZE];		// goto targets
+	int iMask = 0;		// No packet is done yet
+
+	assert(nb_pkts > 0 && nb_pkts <= BATCH_SIZE);
+
+	int temp_index;
+	for(temp_index = 0; temp_index < nb_pkts; temp_index ++) {
+		batch_rips[temp_index] = &&fpp_start;
+	}
+
+	stage_input_init(srv_stage, &in, pkts, nb_pkts);
+
+fpp_start:
+
+	/**< The header is rewritten for TX. Keys past its cacheline (e.g., in
+	  *  the payload) need another prefetch. */
+	rte_prefetch0((const char *) stage_input_key(&in, I) + in.key_len - 1);
+	FPP_PSS(in.base[I], fpp_label_0, nb_pkts);
+fpp_label_0:
+
+	eth_hdr[I] = (struct ether_hdr *) in.base[I];
+
+	/**< The client's request, in place */
+	req[I] = (int *) (in.base[I] + STAGE_REQ_OFFSET);
+
+	addr[I] = srv_stage->start(stage_table, &ctx[I], stage_input_key(&in, I));
+	while(addr[I] != NULL) {
+		FPP_PSS(addr[I], fpp_label_1, nb_pkts);
+fpp_label_1:
+
+		stage_stats->nb_steps ++;
+		addr[I] = srv_stage->step(stage_table, &ctx[I]);
+	}
+
+	stage_stats->nb_lookups ++;
+	stage_stats->nb_hits += ctx[I].hit;
+	dst_port[I] = ctx[I].dst_port;
+
+	/**< TX boilerplate: use the computed next_hop for L2 src and dst. */
+	int *mac_ints_dst = (int *) eth_hdr[I];
+	mac_ints_dst[0] = mac_ints_arr[dst_port[I]].chunk[0];
+	mac_ints_dst[1] = mac_ints_arr[dst_port[I]].chunk[1];
+	mac_ints_dst[2] = mac_ints_arr[dst_port[I]].chunk[2];
+
+	/**< Garble dst MAC to reduce RX load on clients */
+	eth_hdr[I]->d_addr.addr_bytes[0] += ((req[I][0] >> 8) & 0xff);
+
+	tx_ports[I] = mac_ints_arr[dst_port[I]].port_id;
+
+fpp_end:
+	batch_rips[I] = &&fpp_end;
+	iMask = FPP_SET(iMask, I); 
+	if(iMask == (1 << nb_pkts) - 1) {
+		return;
+	}
+	I = (I + 1) < nb_pkts ? I + 1 : 0;
+	goto *batch_rips[I];
+}
+
+/**
+ * Construct the mac ints for the 4 possible lookup results. This allows us
+ * to set the Ethernet header during TX in 3 integer copies. With fewer than
+ * 4 ports in port_mask, results wrap around them.
+ */
+void srv_mac_ints_init(struct mac_ints *mac_ints_arr, int port_mask)
 {
 	int i;
+	int num_active_ports = bitcount(port_mask);
+	int *port_arr = get_active_bits(port_mask);
+
+	assert(num_active_ports > 0 && num_active_ports <= 4);
+	for(i = 0; i < 4; i ++) {
+		int port_id = port_arr[i % num_active_ports];
+		uint8_t *hack_bytes = (uint8_t *) mac_ints_arr[i].chunk;
+
+		if(l2fwd_conf == NULL) {
+			set_mac(&hack_bytes[0], dst_mac_arr[port_id]);
+			set_mac(&hack_bytes[6], src_mac_arr[port_id]);
+		} else {
+			set_mac(&hack_bytes[0], l2fwd_conf->dst_mac[port_id]);
+			set_mac(&hack_bytes[6], l2fwd_conf->src_mac[port_id]);
+		}
+
+		mac_ints_arr[i].port_id = port_id;
+	}
+
+	free(port_arr);
+}
+
+void run_server(void)
+{
+	int i, queue_id;
+	double ns_fac;		/**< Cycles to nanoseconds */
 
 	int lcore_id = rte_lcore_id();
 	int socket_id = rte_lcore_to_socket_id(lcore_id);
-	assert(socket_id == 0);
 
-	int queue_id = get_lcore_rank(lcore_id, socket_id);
-	printf("Server on lcore %d. Queue Id = %d\n", lcore_id, queue_id);
+	/**< The n-th server lcore of a socket uses queue n of its socket's ports */
+	queue_id = topo_lcore_queue(lcore_id);
+	if(l2fwd_conf == NULL) {
+		ns_fac = S_FAC;
+	} else {
+		ns_fac = (double) GHZ_CPS / rte_get_tsc_hz();
+	}
+
+	int port_mask = topo.socket_port_mask[socket_id];
+	if(port_mask == 0) {
+		red_printf("Server on lcore %d: no server ports on socket %d. "
+			"Exiting.\n", lcore_id, socket_id);
+		return;
+	}
+
+	void *stage_table = srv_stage_tables[socket_id];
 
-	/**< This check is required because the process_batch_gpu function
-	  *  uses the GPU's resp to determine the port to send the packet
-	  *  on as follows: port = resp % 4 */
-	assert(XIA_R2_PORT_MASK == 0xf);
+	printf("Server on lcore %d, socket %d. Queue Id = %d, ports = 0x%x\n",
+		lcore_id, socket_id, queue_id, port_mask);
 
-	int num_active_ports = bitcount(XIA_R2_PORT_MASK);
-	int *port_arr = get_active_bits(XIA_R2_PORT_MASK);
+	int num_active_ports = bitcount(port_mask);
+	int *port_arr = get_active_bits(port_mask);
 
-	/**< Construct the mac ints for all 4 ports. This allows us to set the
-	  *  Ethernet header during TX in 3 integer copies. */
-	assert(num_active_ports <= 4);
 	struct mac_ints mac_ints_arr[4];
-	for(i = 0; i < 4; i ++) {
-		uint8_t *hack_bytes = (uint8_t *) mac_ints_arr[i].chunk;
-		set_mac(&hack_bytes[0], dst_mac_arr[i]);
-		set_mac(&hack_bytes[6], src_mac_arr[i]);
-	}
-	
+	srv_mac_ints_init(mac_ints_arr, port_mask);
+
 	/**< Initialize the per-port info for this lcore */
 	struct lcore_port_info lp_info[RTE_MAX_ETHPORTS];
 	memset(lp_info, 0, RTE_MAX_ETHPORTS * sizeof(struct lcore_port_info));
 	for(i = 0; i < RTE_MAX_ETHPORTS; i ++) {
 		lp_info[i].queue_id = queue_id;
+		lp_info[i].tx_burst = MAX_SRV_BURST;
 	}
 
 	struct rte_mbuf *rx_pkts_burst[MAX_SRV_BURST];
+	int tx_ports[MAX_SRV_BURST];
 	int port_index = 0;
 
+	/**< stage_stats is reset when it is printed: stage_tot keeps the rest */
+	struct stage_stats stage_stats, stage_tot;
+	memset(&stage_stats, 0, sizeof(struct stage_stats));
+	memset(&stage_tot, 0, sizeof(struct stage_stats));
+
+	struct telem *telem = telem_init(lcore_id, queue_id, port_mask);
+	LL telem_cycles = (LL) rte_get_tsc_hz() * TELEM_PUBLISH_US / 1000000;
+	LL telem_tsc = rte_rdtsc();
+
 	// Init measurement variables
 	LL tput_tsc[2], brst_sz_msr[4];
 	tput_tsc[0] = rte_rdtsc();
 	memset(brst_sz_msr, 0, 4 * sizeof(LL));
 
+	LL drain_cycles = (LL) rte_get_tsc_hz() * SRV_TX_DRAIN_US / 1000000;
+	LL drain_tsc = rte_rdtsc();
+
 	while (1) {
 		int port_id = port_arr[port_index];	// The port to use in this iteration
 		int nb_rx_new = 0, tries = 0;
+
+		LL cur_tsc = rte_rdtsc();
+		if(unlikely(cur_tsc - drain_tsc >= drain_cycles)) {
+			drain_ports(port_arr, num_active_ports, lp_info);
+			drain_tsc = cur_tsc;
+		}
+
+		if(unlikely(cur_tsc - telem_tsc >= telem_cycles)) {
+			telem_publish(telem, lp_info, &stage_tot, &stage_stats);
+			telem_tsc = cur_tsc;
+		}
 		
 		/**< Lcores *cannot* wait for a fixed number of packets from a port.
 		  *  If we do this, the port mysteriously runs out of RX desc */
@@ -145,6 +327,8 @@ void run_server(void)
 			tries ++;
 		}
 		
+		lp_info[port_id].telem.rx_burst[telem_burst_bucket(nb_rx_new)] ++;
+
 		if(nb_rx_new == 0) {
 			port_index = (port_index + 1) < num_active_ports ? port_index + 1 : 0;
 			continue;
@@ -155,13 +339,27 @@ void run_server(void)
 		brst_sz_msr[MSR_TOT] += nb_rx_new;
 	
 		lp_info[port_id].nb_rx += nb_rx_new;
+		lp_info[port_id].telem.nb_rx += nb_rx_new;
+
+		LL batch_tsc = rte_rdtsc();
+		if(SRV_USE_GOTO) {
+			process_batch_goto(rx_pkts_burst, nb_rx_new, stage_table,
+				mac_ints_arr, tx_ports, &stage_stats);
+		} else {
+			process_batch_nogoto(rx_pkts_burst, nb_rx_new, stage_table,
+				mac_ints_arr, tx_ports, &stage_stats);
+		}
+
+		for(i = 0; i < nb_rx_new; i ++) {
+			send_packet(rx_pkts_burst[i], tx_ports[i], lp_info);
+		}
 
-		process_batch_nogoto(rx_pkts_burst, nb_rx_new, lp_info, mac_ints_arr);
+		stage_stats.nb_cycles += rte_rdtsc() - batch_tsc;
 		
 		/**< STAT PRINTING */
 		if (unlikely(lp_info[0].nb_tx_all_ports >= 10000000)) {
 			tput_tsc[1] = rte_rdtsc();
-			double nanoseconds = S_FAC * (tput_tsc[1] - tput_tsc[0]);
+			double nanoseconds = ns_fac * (tput_tsc[1] - tput_tsc[0]);
 			double seconds = nanoseconds / GHZ_CPS;
 			tput_tsc[0] = tput_tsc[1];
 
@@ -171,18 +369,21 @@ void run_server(void)
 			/**< Reset all-port stats in case port 0 is disabled */
 			lp_info[0].nb_tx_all_ports = 0;
 			for(i = 0; i < RTE_MAX_ETHPORTS; i++) {
-				if(ISSET(XIA_R2_PORT_MASK, i)) {
-					printf("\tLcore: %d, port: %d: %f\n", lcore_id, i, 
-						lp_info[i].nb_tx / seconds);
+				if(ISSET(port_mask, i)) {
+					printf("\tLcore: %d, port: %d: %f, TX batch: %d\n",
+						lcore_id, i, lp_info[i].nb_tx / seconds,
+						lp_info[i].tx_burst);
 				}
 
-				/**< Do not reset the nb_buf counter */
+				/**< Do not reset the nb_buf counter or the TX batch size */
 				lp_info[i].nb_tx = 0;
 				lp_info[i].nb_rx = 0;
 			}
 
-			printf("\tLcore %d, Average TX burst size: %lld\n", lcore_id, 
+			printf("\tLcore %d, Average RX burst size: %lld\n", lcore_id, 
 				brst_sz_msr[MSR_TOT] / brst_sz_msr[MSR_SAMPLES]);
+			stage_stats_add(&stage_tot, &stage_stats);
+			stage_print_stats(srv_stage, &stage_stats, lcore_id);
 			printf("\n");
 
 			memset(brst_sz_msr, 0, 4 * sizeof(LL));
@@ -0,0 +1,920 @@
+/* Lookup stages for the server: see stage.h */
+#include "main.h"
+
+#include <rte_malloc.h>
+#include <rte_hash_crc.h>
+
+#include "city.h"
+
+/**< Port stage: the request names the port. No table. */
+static void *port_init(__attribute__((unused)) int socket_id)
+{
+	return NULL;
+}
+
+static const void *port_start(__attribute__((unused)) void *table,
+	struct stage_ctx *ctx, const void *key)
+{
+	ctx->key = *(const uint32_t *) key;
+	ctx->hit = 1;
+	ctx->dst_port = ctx->key & 3;
+	return NULL;
+}
+
+static const void *port_step(__attribute__((unused)) void *table,
+	__attribute__((unused)) struct stage_ctx *ctx)
+{
+	assert(0);
+	return NULL;
+}
+
+/**< Cuckoo stage: 2-choice, 8-way cuckoo hash like antlr/actual/ht-cuckoo.
+  *  The key is the request; the value is the port. */
+struct stage_cuckoo_slot {
+	int key;
+	int value;
+};
+
+struct stage_cuckoo_bkt {
+	struct stage_cuckoo_slot slot[8];
+};
+
+static inline uint32_t stage_cuckoo_hash(uint32_t u)
+{
+	return rte_hash_crc_4byte(u, 0xdeadbeef);
+}
+
+static void *cuckoo_init(int socket_id)
+{
+	int i, slot_i, failed_inserts = 0;
+
+	struct stage_cuckoo_bkt *ht_index = rte_zmalloc_socket("stage_cuckoo",
+		STAGE_CUCKOO_NUM_BKT * sizeof(struct stage_cuckoo_bkt),
+		CACHE_LINE_SIZE, socket_id);
+	CPE(ht_index == NULL, "Cannot allocate cuckoo stage\n");
+
+	printf("\tStage cuckoo: inserting %d keys into %d buckets\n",
+		STAGE_CUCKOO_NUM_KEYS, STAGE_CUCKOO_NUM_BKT);
+
+	/**< Key 0 marks an empty slot, so start from 1 */
+	for(i = 1; i < STAGE_CUCKOO_NUM_KEYS; i ++) {
+		int bkt = stage_cuckoo_hash(i) & STAGE_CUCKOO_NUM_BKT_;
+		if(rand() % 2 == 0) {
+			bkt = stage_cuckoo_hash(bkt) & STAGE_CUCKOO_NUM_BKT_;
+		}
+
+		for(slot_i = 0; slot_i < 8; slot_i ++) {
+			if(ht_index[bkt].slot[slot_i].key == 0) {
+				ht_index[bkt].slot[slot_i].key = i;
+				ht_index[bkt].slot[slot_i].value = rand() & 3;
+				break;
+			}
+		}
+
+		if(slot_i == 8) {
+			failed_inserts ++;
+		}
+	}
+
+	printf("\tStage cuckoo: fraction of failed inserts = %f\n",
+		(double) failed_inserts / STAGE_CUCKOO_NUM_KEYS);
+	return ht_index;
+}
+
+static const void *cuckoo_start(void *table, struct stage_ctx *ctx,
+	const void *key)
+{
+	struct stage_cuckoo_bkt *ht_index = table;
+
+	ctx->key = *(const uint32_t *) key & STAGE_CUCKOO_NUM_KEYS_;
+	ctx->step = 0;
+	ctx->index = stage_cuckoo_hash(ctx->key) & STAGE_CUCKOO_NUM_BKT_;
+	return &ht_index[ctx->index];
+}
+
+static const void *cuckoo_step(void *table, struct stage_ctx *ctx)
+{
+	int i;
+	struct stage_cuckoo_bkt *bkt = &((struct stage_cuckoo_bkt *) table)[ctx->index];
+
+	for(i = 0; i < 8; i ++) {
+		if(bkt->slot[i].key == (int) ctx->key) {
+			ctx->hit = 1;
+			ctx->dst_port = bkt->slot[i].value;
+			return NULL;
+		}
+	}
+
+	/**< Try the second bucket */
+	if(ctx->step == 0) {
+		ctx->step = 1;
+		ctx->index = stage_cuckoo_hash(ctx->index) & STAGE_CUCKOO_NUM_BKT_;
+		return &((struct stage_cuckoo_bkt *) table)[ctx->index];
+	}
+
+	ctx->hit = 0;
+	ctx->dst_port = ctx->key & 3;
+	return NULL;
+}
+
+/**< LPM stage: DPDK's rte_lpm on the IPv4 destination address, with the
+  *  tbl24 and tbl8 accesses of rte_lpm_lookup() as separate steps */
+static void *lpm_init(int socket_id)
+{
+	int i;
+
+	struct rte_lpm *lpm = rte_lpm_create("stage_lpm", socket_id,
+		STAGE_LPM_NUM_PREFIXES, 0);
+	CPE(lpm == NULL, "Cannot create LPM stage\n");
+
+	printf("\tStage lpm: adding %d random prefixes\n", STAGE_LPM_NUM_PREFIXES);
+	for(i = 0; i < STAGE_LPM_NUM_PREFIXES; i ++) {
+		uint8_t depth = 8 + rand() % 25;		/**< 8 to 32 */
+		int ret = rte_lpm_add(lpm, (uint32_t) rand(), depth, rand() & 3);
+		CPE(ret < 0, "Cannot add prefix to LPM stage\n");
+	}
+
+	return lpm;
+}
+
+static const void *lpm_start(void *table, struct stage_ctx *ctx,
+	const void *key)
+{
+	struct rte_lpm *lpm = table;
+
+	ctx->key = *(const uint32_t *) key;
+	ctx->step = 0;
+	ctx->index = ctx->key >> 8;
+	return &lpm->tbl24[ctx->index];
+}
+
+static const void *lpm_step(void *table, struct stage_ctx *ctx)
+{
+	struct rte_lpm *lpm = table;
+	uint16_t tbl_entry;
+
+	if(ctx->step == 0) {
+		tbl_entry = *(const uint16_t *) &lpm->tbl24[ctx->index];
+
+		if(unlikely((tbl_entry & RTE_LPM_VALID_EXT_ENTRY_BITMASK) ==
+			RTE_LPM_VALID_EXT_ENTRY_BITMASK)) {
+			ctx->step = 1;
+			ctx->index = (uint8_t) ctx->key +
+				((uint8_t) tbl_entry * RTE_LPM_TBL8_GROUP_NUM_ENTRIES);
+			return &lpm->tbl8[ctx->index];
+		}
+	} else {
+		tbl_entry = *(const uint16_t *) &lpm->tbl8[ctx->index];
+	}
+
+	ctx->hit = (tbl_entry & RTE_LPM_LOOKUP_SUCCESS) ? 1 : 0;
+	ctx->dst_port = ctx->hit ? ((uint8_t) tbl_entry & 3) : (ctx->key & 3);
+	return NULL;
+}
+
+/**< LPM6 stage: the tbl24 and tbl8s of antlr/actual/ipv6's rte_lpm6 (a copy
+  *  of DPDK's rte_lpm6, whose tables are private), built here without the
+  *  rules table. The tbl24 access and each tbl8 access of rte_lpm6_lookup()
+  *  is a step. */
+#define STAGE_LPM6_TBL24_NUM_ENTRIES (1 << 24)
+#define STAGE_LPM6_TBL8_GROUP_NUM_ENTRIES 256
+
+#define STAGE_LPM6_VALID_EXT_ENTRY_BITMASK 0xA0000000
+#define STAGE_LPM6_LOOKUP_SUCCESS 0x20000000
+#define STAGE_LPM6_TBL8_BITMASK 0x001FFFFF
+
+/**< The same for tbl24 and tbl8. next_hop is the tbl8 group of an extended
+  *  entry. */
+struct stage_lpm6_entry {
+	uint32_t next_hop :21;
+	uint32_t depth :8;
+	uint32_t valid :1;
+	uint32_t valid_group :1;
+	uint32_t ext_entry :1;
+};
+
+struct stage_lpm6 {
+	struct stage_lpm6_entry *tbl24;
+	struct stage_lpm6_entry *tbl8;
+	uint32_t next_tbl8;
+};
+
+/**< Zero the bits of ip after the first depth bits */
+static void lpm6_mask_ip(uint8_t *ip, int depth)
+{
+	int i;
+
+	for(i = 0; i < STAGE_LPM6_ADDR_SIZE; i ++, depth -= 8) {
+		if(depth <= 0) {
+			ip[i] = 0;
+		} else if(depth < 8) {
+			ip[i] &= (uint8_t) ~(0xff >> depth);
+		}
+	}
+}
+
+/**< Write a rule into the tbl8 group at tbl8_gindex and the groups below it,
+  *  except where a longer rule is */
+static void lpm6_expand_rule(struct stage_lpm6 *lpm6, uint32_t tbl8_gindex,
+	int depth, int next_hop)
+{
+	uint32_t j;
+	struct stage_lpm6_entry new_entry = {
+		.next_hop = next_hop, .depth = depth,
+		.valid = 1, .valid_group = 1, .ext_entry = 0,
+	};
+
+	for(j = tbl8_gindex; j < tbl8_gindex + STAGE_LPM6_TBL8_GROUP_NUM_ENTRIES;
+		j ++) {
+		struct stage_lpm6_entry *entry = &lpm6->tbl8[j];
+
+		if(!entry->valid || (entry->ext_entry == 0 && entry->depth <= depth)) {
+			*entry = new_entry;
+		} else if(entry->ext_entry == 1) {
+			lpm6_expand_rule(lpm6, entry->next_hop *
+				STAGE_LPM6_TBL8_GROUP_NUM_ENTRIES, depth, next_hop);
+		}
+	}
+}
+
+/**< add_step() of rte_lpm6: tbl resolves bytes first_byte to
+  *  first_byte + bytes - 1 of ip. Returns 0 when the rule is written, 1 with
+  *  *tbl_next set if it continues in a tbl8, and -1 without free tbl8s. */
+static int lpm6_add_step(struct stage_lpm6 *lpm6, struct stage_lpm6_entry *tbl,
+	struct stage_lpm6_entry **tbl_next, const uint8_t *ip, int first_byte,
+	int bytes, int depth, int next_hop)
+{
+	uint32_t i, tbl_index = 0;
+	int bits_covered = (first_byte + bytes) * 8;
+
+	for(i = first_byte; i < (uint32_t) (first_byte + bytes); i ++) {
+		tbl_index = (tbl_index << 8) | ip[i];
+	}
+
+	/**< The last step: write the rule over its range of this table */
+	if(depth <= bits_covered) {
+		struct stage_lpm6_entry new_entry = {
+			.next_hop = next_hop, .depth = depth,
+			.valid = 1, .valid_group = 1, .ext_entry = 0,
+		};
+
+		for(i = tbl_index; i < tbl_index + (1 << (bits_covered - depth)); i ++) {
+			if(!tbl[i].valid || (tbl[i].ext_entry == 0 && tbl[i].depth <= depth)) {
+				tbl[i] = new_entry;
+			} else if(tbl[i].ext_entry == 1) {
+				lpm6_expand_rule(lpm6, tbl[i].next_hop *
+					STAGE_LPM6_TBL8_GROUP_NUM_ENTRIES, depth, next_hop);
+			}
+		}
+
+		return 0;
+	}
+
+	/**< Otherwise the entry must point to a tbl8. A shorter rule that is
+	  *  already there moves into the new tbl8. */
+	if(!tbl[tbl_index].valid || tbl[tbl_index].ext_entry == 0) {
+		if(lpm6->next_tbl8 == STAGE_LPM6_NUM_TBL8S) {
+			return -1;
+		}
+
+		uint32_t tbl8_gindex = lpm6->next_tbl8 ++;
+		if(tbl[tbl_index].valid) {
+			struct stage_lpm6_entry *group =
+				&lpm6->tbl8[tbl8_gindex * STAGE_LPM6_TBL8_GROUP_NUM_ENTRIES];
+			for(i = 0; i < STAGE_LPM6_TBL8_GROUP_NUM_ENTRIES; i ++) {
+				group[i].valid = 1;
+				group[i].depth = tbl[tbl_index].depth;
+				group[i].next_hop = tbl[tbl_index].next_hop;
+				group[i].ext_entry = 0;
+			}
+		}
+
+		struct stage_lpm6_entry new_entry = {
+			.next_hop = tbl8_gindex, .depth = 0,
+			.valid = 1, .valid_group = 1, .ext_entry = 1,
+		};
+		tbl[tbl_index] = new_entry;
+	}
+
+	*tbl_next = &lpm6->tbl8[tbl[tbl_index].next_hop *
+		STAGE_LPM6_TBL8_GROUP_NUM_ENTRIES];
+	return 1;
+}
+
+/**< rte_lpm6_add() without the rules table. Returns -1 without free tbl8s. */
+static int lpm6_add(struct stage_lpm6 *lpm6, const uint8_t *ip, int depth,
+	int next_hop)
+{
+	int i, status;
+	uint8_t masked_ip[STAGE_LPM6_ADDR_SIZE];
+	struct stage_lpm6_entry *tbl_next;
+
+	assert(depth >= 1 && depth <= STAGE_LPM6_ADDR_SIZE * 8);
+	memcpy(masked_ip, ip, STAGE_LPM6_ADDR_SIZE);
+	lpm6_mask_ip(masked_ip, depth);
+
+	/**< tbl24 resolves the first three bytes, each tbl8 one more */
+	status = lpm6_add_step(lpm6, lpm6->tbl24, &tbl_next, masked_ip, 0, 3,
+		depth, next_hop);
+	for(i = 3; i < STAGE_LPM6_ADDR_SIZE && status == 1; i ++) {
+		status = lpm6_add_step(lpm6, tbl_next, &tbl_next, masked_ip, i, 1,
+			depth, next_hop);
+	}
+
+	return status;
+}
+
+static void *lpm6_init(int socket_id)
+{
+	int i;
+
+	struct stage_lpm6 *lpm6 = rte_zmalloc_socket("stage_lpm6",
+		sizeof(struct stage_lpm6), CACHE_LINE_SIZE, socket_id);
+	CPE(lpm6 == NULL, "Cannot allocate LPM6 stage\n");
+
+	lpm6->tbl24 = rte_zmalloc_socket("stage_lpm6_tbl24",
+		STAGE_LPM6_TBL24_NUM_ENTRIES * sizeof(struct stage_lpm6_entry),
+		CACHE_LINE_SIZE, socket_id);
+	lpm6->tbl8 = rte_zmalloc_socket("stage_lpm6_tbl8",
+		(size_t) STAGE_LPM6_NUM_TBL8S * STAGE_LPM6_TBL8_GROUP_NUM_ENTRIES *
+		sizeof(struct stage_lpm6_entry), CACHE_LINE_SIZE, socket_id);
+	CPE(lpm6->tbl24 == NULL || lpm6->tbl8 == NULL,
+		"Cannot allocate LPM6 stage\n");
+
+	printf("\tStage lpm6: adding %d flow prefixes\n", STAGE_LPM6_NUM_PREFIXES);
+	for(i = 0; i < STAGE_LPM6_NUM_PREFIXES; i ++) {
+		uint8_t ip[STAGE_LPM6_ADDR_SIZE];
+		stage_flow_ipv6(i, ip);
+
+		int depth = 48 + rand() % 17;		/**< 48 to 64 */
+		int ret = lpm6_add(lpm6, ip, depth, rand() & 3);
+		CPE(ret < 0, "Cannot add prefix to LPM6 stage\n");
+	}
+
+	printf("\tStage lpm6: used %u tbl8s\n", lpm6->next_tbl8);
+	return lpm6;
+}
+
+static const void *lpm6_start(void *table, struct stage_ctx *ctx,
+	const void *key)
+{
+	struct stage_lpm6 *lpm6 = table;
+
+	ctx->in = key;
+	ctx->step = 0;
+	ctx->index = (ctx->in[0] << 16) | (ctx->in[1] << 8) | ctx->in[2];
+	return &lpm6->tbl24[ctx->index];
+}
+
+/**< ctx->step is the number of tbl8s read before this step: tbl8 k resolves
+  *  byte 2 + k of the address */
+static const void *lpm6_step(void *table, struct stage_ctx *ctx)
+{
+	struct stage_lpm6 *lpm6 = table;
+	const struct stage_lpm6_entry *tbl =
+		ctx->step == 0 ? lpm6->tbl24 : lpm6->tbl8;
+	uint32_t tbl_entry = *(const uint32_t *) &tbl[ctx->index];
+
+	if((tbl_entry & STAGE_LPM6_VALID_EXT_ENTRY_BITMASK) ==
+		STAGE_LPM6_VALID_EXT_ENTRY_BITMASK) {
+		ctx->step ++;
+		ctx->index = ctx->in[2 + ctx->step] +
+			(tbl_entry & STAGE_LPM6_TBL8_BITMASK) *
+			STAGE_LPM6_TBL8_GROUP_NUM_ENTRIES;
+		return &lpm6->tbl8[ctx->index];
+	}
+
+	ctx->hit = (tbl_entry & STAGE_LPM6_LOOKUP_SUCCESS) ? 1 : 0;
+	ctx->dst_port = ctx->hit ? ((uint8_t) tbl_entry & 3) : (ctx->in[0] & 3);
+	return NULL;
+}
+
+/**< MICA stage: a GET in antlr/actual/mica's lossy index and circular log.
+  *  The key is the 8-byte key hash in the payload. An index slot holds a
+  *  16-bit tag of the hash and the log index; the log holds the hash and
+  *  the port. */
+struct stage_mica_kv {
+	uint64_t key;
+	uint64_t value;
+};
+
+struct stage_mica_bkt {
+	uint64_t slots[8];
+};
+
+struct stage_mica {
+	struct stage_mica_bkt *ht_index;
+	struct stage_mica_kv *ht_log;
+};
+
+#define STAGE_MICA_INVALID_LOG_I ((uint64_t) (STAGE_MICA_LOG_CAP + 1))
+
+#define STAGE_MICA_SLOT_TO_LOG_I(s) ((s) >> 16)
+#define STAGE_MICA_SLOT_TO_TAG(s) ((int) ((s) & 0xffff))
+
+#define STAGE_MICA_HASH_TO_TAG(h) ((int) ((h) & 0xffff))
+#define STAGE_MICA_HASH_TO_BUCKET(h) ((int) (((h) >> 16) & STAGE_MICA_INDEX_N_))
+
+static void *mica_init(int socket_id)
+{
+	int i, j;
+	uint64_t log_i = 0;
+
+	struct stage_mica *mica = rte_zmalloc_socket("stage_mica",
+		sizeof(struct stage_mica), CACHE_LINE_SIZE, socket_id);
+	CPE(mica == NULL, "Cannot allocate MICA stage\n");
+
+	mica->ht_index = rte_malloc_socket("stage_mica_index",
+		STAGE_MICA_INDEX_N * sizeof(struct stage_mica_bkt),
+		CACHE_LINE_SIZE, socket_id);
+	mica->ht_log = rte_malloc_socket("stage_mica_log",
+		STAGE_MICA_LOG_CAP * sizeof(struct stage_mica_kv),
+		CACHE_LINE_SIZE, socket_id);
+	CPE(mica->ht_index == NULL || mica->ht_log == NULL,
+		"Cannot allocate MICA stage\n");
+
+	/**< Mark all index slots invalid */
+	for(i = 0; i < STAGE_MICA_INDEX_N; i ++) {
+		for(j = 0; j < 8; j ++) {
+			mica->ht_index[i].slots[j] = STAGE_MICA_INVALID_LOG_I << 16;
+		}
+	}
+
+	printf("\tStage mica: inserting %d keys into %d buckets\n",
+		STAGE_MICA_NUM_KEYS - 1, STAGE_MICA_INDEX_N);
+
+	for(i = 1; i < STAGE_MICA_NUM_KEYS; i ++) {
+		uint64_t key_hash = stage_key_hash(i);
+		uint64_t slot = STAGE_MICA_HASH_TO_TAG(key_hash) |
+			((log_i & STAGE_MICA_LOG_CAP_) << 16);
+
+		uint64_t *slots =
+			mica->ht_index[STAGE_MICA_HASH_TO_BUCKET(key_hash)].slots;
+		for(j = 0; j < 8; j ++) {
+			if(STAGE_MICA_SLOT_TO_LOG_I(slots[j]) == STAGE_MICA_INVALID_LOG_I) {
+				break;
+			}
+		}
+
+		/**< The index is lossy: evict a random slot if the bucket is full */
+		slots[j < 8 ? j : rand() & 7] = slot;
+
+		mica->ht_log[log_i & STAGE_MICA_LOG_CAP_].key = key_hash;
+		mica->ht_log[log_i & STAGE_MICA_LOG_CAP_].value = rand() & 3;
+		log_i ++;
+	}
+
+	return mica;
+}
+
+static const void *mica_start(void *table, struct stage_ctx *ctx,
+	const void *key)
+{
+	struct stage_mica *mica = table;
+
+	ctx->key = *(const uint64_t *) key;
+	ctx->step = 0;
+	ctx->index = STAGE_MICA_HASH_TO_BUCKET(ctx->key);
+	return &mica->ht_index[ctx->index];
+}
+
+/**< ctx->step is the index slot to check next. Slot ctx->step - 1's log
+  *  entry is ready when ctx->step > 0. */
+static const void *mica_step(void *table, struct stage_ctx *ctx)
+{
+	int i;
+	struct stage_mica *mica = table;
+	uint64_t *slots = mica->ht_index[ctx->index].slots;
+
+	if(ctx->step > 0) {
+		struct stage_mica_kv *kv =
+			&mica->ht_log[STAGE_MICA_SLOT_TO_LOG_I(slots[ctx->step - 1])];
+		if(kv->key == ctx->key) {
+			ctx->hit = 1;
+			ctx->dst_port = kv->value;
+			return NULL;
+		}
+	}
+
+	for(i = ctx->step; i < 8; i ++) {
+		if(STAGE_MICA_SLOT_TO_TAG(slots[i]) == STAGE_MICA_HASH_TO_TAG(ctx->key) &&
+			STAGE_MICA_SLOT_TO_LOG_I(slots[i]) != STAGE_MICA_INVALID_LOG_I) {
+			ctx->step = i + 1;
+			return &mica->ht_log[STAGE_MICA_SLOT_TO_LOG_I(slots[i])];
+		}
+	}
+
+	ctx->hit = 0;
+	ctx->dst_port = ctx->key & 3;
+	return NULL;
+}
+
+/**< NDN stage: antlr/actual/ndn's name lookup. Every '/'-terminated prefix
+  *  of the FIB's names is in a 2-choice, 8-way hash table. A name is looked
+  *  up one prefix at a time, from its 2-component prefix like nogoto.c
+  *  there, until a terminal prefix matches; the last match gives the port.
+  *  Each bucket probe is a step. */
+struct stage_ndn_slot {
+	int8_t dst_port;			/**< -1 for invalid slots */
+	uint8_t is_terminal;
+	uint64_t hash;
+	uint8_t pad[6];
+} __attribute__((__packed__));
+
+struct stage_ndn_bkt {
+	struct stage_ndn_slot slots[8];
+};
+
+static inline uint64_t stage_ndn_hash(const char *prefix, int len)
+{
+	return CityHash64WithSeed(prefix, len, STAGE_NDN_SEED);
+}
+
+/**< The second bucket depends only on the first one and the hash's tag */
+static inline uint32_t stage_ndn_bkt_2(uint64_t hash)
+{
+	uint16_t tag = hash >> 48;
+	return ((hash & STAGE_NDN_NUM_BKT_) ^ CityHash64((char *) &tag, 2)) &
+		STAGE_NDN_NUM_BKT_;
+}
+
+/**< Insert a prefix. If it is there already, a terminal prefix takes the
+  *  new port and a non-terminal one makes the entry non-terminal. Returns
+  *  -1 if both buckets are full: there are no cuckoo evictions. */
+static int ndn_insert(struct stage_ndn_bkt *ht, const char *prefix, int len,
+	int is_terminal, int dst_port)
+{
+	int b, i;
+	uint64_t hash = stage_ndn_hash(prefix, len);
+	uint32_t bkt[2] = {hash & STAGE_NDN_NUM_BKT_, stage_ndn_bkt_2(hash)};
+
+	for(b = 0; b < 2; b ++) {
+		struct stage_ndn_slot *slots = ht[bkt[b]].slots;
+		for(i = 0; i < 8; i ++) {
+			if(slots[i].dst_port >= 0 && slots[i].hash == hash) {
+				if(is_terminal) {
+					slots[i].dst_port = dst_port;
+				} else {
+					slots[i].is_terminal = 0;
+				}
+				return 0;
+			}
+		}
+	}
+
+	for(b = 0; b < 2; b ++) {
+		struct stage_ndn_slot *slots = ht[bkt[b]].slots;
+		for(i = 0; i < 8; i ++) {
+			if(slots[i].dst_port == -1) {
+				slots[i].dst_port = dst_port;
+				slots[i].is_terminal = is_terminal;
+				slots[i].hash = hash;
+				return 0;
+			}
+		}
+	}
+
+	return -1;
+}
+
+static void *ndn_init(int socket_id)
+{
+	int i, j, nb_names = 0, nb_fail = 0;
+	char name[STAGE_NDN_MAX_NAME_LEN + 2];
+
+	struct stage_ndn_bkt *ht = rte_malloc_socket("stage_ndn",
+		STAGE_NDN_NUM_BKT * sizeof(struct stage_ndn_bkt),
+		CACHE_LINE_SIZE, socket_id);
+	CPE(ht == NULL, "Cannot allocate NDN stage\n");
+
+	/**< Mark all slots invalid */
+	memset(ht, 0, STAGE_NDN_NUM_BKT * sizeof(struct stage_ndn_bkt));
+	for(i = 0; i < STAGE_NDN_NUM_BKT; i ++) {
+		for(j = 0; j < 8; j ++) {
+			ht[i].slots[j].dst_port = -1;
+		}
+	}
+
+	FILE *fib_fp = fopen(STAGE_NDN_FIB_FILE, "r");
+	CPE(fib_fp == NULL, "Cannot open " STAGE_NDN_FIB_FILE "\n");
+
+	printf("\tStage ndn: inserting the prefixes of %s\n", STAGE_NDN_FIB_FILE);
+	while(fgets(name, sizeof(name), fib_fp) != NULL) {
+		int len = strcspn(name, "\r\n");
+		CPE1(len >= STAGE_NDN_MAX_NAME_LEN, "NDN name %d is too long\n",
+			nb_names);
+		if(len == 0) {
+			continue;
+		}
+
+		name[len] = 0;
+		CPE1(name[len - 1] != '/', "NDN name %d does not end with '/'\n",
+			nb_names);
+
+		/**< All prefixes of a name get its port. The name is terminal. */
+		int dst_port = rand() & 3;
+		for(i = 0; i < len; i ++) {
+			if(name[i] == '/' &&
+				ndn_insert(ht, name, i + 1, i == len - 1, dst_port) != 0) {
+				nb_fail ++;
+			}
+		}
+
+		nb_names ++;
+	}
+
+	fclose(fib_fp);
+	printf("\tStage ndn: %d names, %d prefixes failed to insert\n",
+		nb_names, nb_fail);
+	return ht;
+}
+
+/**< Move to the prefix that ends at the first '/' after ctx->pos. Returns
+  *  its first bucket, or NULL at the end of the name. */
+static const void *ndn_next_prefix(struct stage_ndn_bkt *ht,
+	struct stage_ctx *ctx)
+{
+	const char *name = (const char *) ctx->in;
+	int c_i;
+
+	for(c_i = ctx->pos + 1; c_i < STAGE_NDN_MAX_NAME_LEN && name[c_i] != 0;
+		c_i ++) {
+		if(name[c_i] == '/') {
+			ctx->pos = c_i;
+			ctx->step = 0;
+			ctx->key = stage_ndn_hash(name, c_i + 1);
+			ctx->index = ctx->key & STAGE_NDN_NUM_BKT_;
+			return &ht[ctx->index];
+		}
+	}
+
+	return NULL;
+}
+
+static const void *ndn_start(void *table, struct stage_ctx *ctx,
+	const void *key)
+{
+	ctx->in = key;
+	ctx->hit = 0;
+	ctx->dst_port = ctx->in[0] & 3;
+
+	/**< Skip the first component */
+	for(ctx->pos = 0; ctx->pos < STAGE_NDN_MAX_NAME_LEN; ctx->pos ++) {
+		if(ctx->in[ctx->pos] == '/') {
+			return ndn_next_prefix(table, ctx);
+		}
+
+		if(ctx->in[ctx->pos] == 0) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/**< ctx->step is 0 in the prefix's first bucket and 1 in its second */
+static const void *ndn_step(void *table, struct stage_ctx *ctx)
+{
+	int i;
+	struct stage_ndn_bkt *ht = table;
+	struct stage_ndn_slot *slots = ht[ctx->index].slots;
+
+	for(i = 0; i < 8; i ++) {
+		if(slots[i].dst_port >= 0 && slots[i].hash == ctx->key) {
+			/**< A longer prefix may match later */
+			ctx->hit = 1;
+			ctx->dst_port = slots[i].dst_port;
+			return slots[i].is_terminal ? NULL : ndn_next_prefix(ht, ctx);
+		}
+	}
+
+	if(ctx->step == 0) {
+		ctx->step = 1;
+		ctx->index = stage_ndn_bkt_2(ctx->key);
+		return &ht[ctx->index];
+	}
+
+	return ndn_next_prefix(ht, ctx);
+}
+
+/**< Aho-Corasick stage: antlr/actual/aho-corasick's DFA, with all
+  *  transitions filled in, for the Snort patterns of STAGE_AHO_DFA_ID. Each
+  *  payload byte is a step. A transition also holds the number of patterns
+  *  that end at its target state, so a step reads one cacheline. The port
+  *  is the number of matches & 3. */
+struct stage_aho_trans {
+	uint16_t next;
+	uint16_t count;
+};
+
+struct stage_aho_state {
+	struct stage_aho_trans G[256];
+};
+
+static void *aho_init(int socket_id)
+{
+	int i, j, k, c, nb_patterns, nb_dfa_patterns = 0, nb_states = 1;
+
+	struct stage_aho_state *st_arr = rte_malloc_socket("stage_aho",
+		STAGE_AHO_MAX_STATES * sizeof(struct stage_aho_state),
+		CACHE_LINE_SIZE, socket_id);
+	CPE(st_arr == NULL, "Cannot allocate Aho-Corasick stage\n");
+
+	/**< Failure function, patterns per state and the BFS queue */
+	uint16_t *F = malloc(STAGE_AHO_MAX_STATES * sizeof(uint16_t));
+	uint16_t *count = calloc(STAGE_AHO_MAX_STATES, sizeof(uint16_t));
+	uint16_t *queue = malloc(STAGE_AHO_MAX_STATES * sizeof(uint16_t));
+	assert(F != NULL && count != NULL && queue != NULL);
+
+	for(c = 0; c < 256; c ++) {
+		st_arr[0].G[c].next = STAGE_AHO_MAX_STATES;
+	}
+
+	FILE *pattern_fp = fopen(STAGE_AHO_PATTERN_FILE, "r");
+	CPE(pattern_fp == NULL, "Cannot open " STAGE_AHO_PATTERN_FILE "\n");
+
+	/**< <num_patterns>, then one "<dfa id> <len> <byte 1> ..." per pattern.
+	  *  Add this DFA's patterns to the trie. */
+	CPE(fscanf(pattern_fp, "%d", &nb_patterns) != 1, "Bad pattern file\n");
+	for(i = 0; i < nb_patterns; i ++) {
+		int dfa_id, len, state = 0;
+		CPE(fscanf(pattern_fp, "%d %d", &dfa_id, &len) != 2,
+			"Bad pattern file\n");
+
+		for(j = 0; j < len; j ++) {
+			CPE(fscanf(pattern_fp, "%d", &c) != 1 || c < 0 || c > 255,
+				"Bad pattern file\n");
+			if(dfa_id != STAGE_AHO_DFA_ID) {
+				continue;
+			}
+
+			if(st_arr[state].G[c].next == STAGE_AHO_MAX_STATES) {
+				CPE(nb_states == STAGE_AHO_MAX_STATES,
+					"Too many Aho-Corasick states\n");
+				for(k = 0; k < 256; k ++) {
+					st_arr[nb_states].G[k].next = STAGE_AHO_MAX_STATES;
+				}
+				st_arr[state].G[c].next = nb_states ++;
+			}
+			state = st_arr[state].G[c].next;
+		}
+
+		if(dfa_id == STAGE_AHO_DFA_ID && len > 0) {
+			count[state] ++;
+			nb_dfa_patterns ++;
+		}
+	}
+	fclose(pattern_fp);
+
+	/**< In BFS order, fill in the failure function, the missing transitions
+	  *  (from the failure state, which is shallower and so already complete)
+	  *  and the number of patterns that end at each state */
+	int head = 0, tail = 0;
+	F[0] = 0;
+	queue[tail ++] = 0;
+	while(head < tail) {
+		int state = queue[head ++];
+		for(c = 0; c < 256; c ++) {
+			int child = st_arr[state].G[c].next;
+			int fail_next = state == 0 ? 0 : st_arr[F[state]].G[c].next;
+
+			if(child == STAGE_AHO_MAX_STATES) {
+				st_arr[state].G[c].next = fail_next;
+			} else {
+				F[child] = fail_next;
+				count[child] += count[fail_next];
+				queue[tail ++] = child;
+			}
+		}
+	}
+
+	for(i = 0; i < nb_states; i ++) {
+		for(c = 0; c < 256; c ++) {
+			st_arr[i].G[c].count = count[st_arr[i].G[c].next];
+		}
+	}
+
+	printf("\tStage aho: DFA %d has %d patterns and %d states\n",
+		STAGE_AHO_DFA_ID, nb_dfa_patterns, nb_states);
+
+	free(F);
+	free(count);
+	free(queue);
+	return st_arr;
+}
+
+/**< ctx->pos is the next byte, ctx->index the state and ctx->key counts
+  *  matches */
+static const void *aho_start(void *table, struct stage_ctx *ctx,
+	const void *key)
+{
+	struct stage_aho_state *st_arr = table;
+
+	ctx->in = key;
+	ctx->pos = 0;
+	ctx->index = 0;
+	ctx->key = 0;
+	return &st_arr[0].G[ctx->in[0]];
+}
+
+static const void *aho_step(void *table, struct stage_ctx *ctx)
+{
+	struct stage_aho_state *st_arr = table;
+	struct stage_aho_trans trans = st_arr[ctx->index].G[ctx->in[ctx->pos]];
+
+	ctx->key += trans.count;
+	ctx->index = trans.next;
+	ctx->pos ++;
+
+	if(ctx->pos == STAGE_AHO_PAYLOAD_LEN) {
+		ctx->hit = ctx->key != 0;
+		ctx->dst_port = ctx->key & 3;
+		return NULL;
+	}
+
+	return &st_arr[ctx->index].G[ctx->in[ctx->pos]];
+}
+
+static const struct lookup_stage stages[] = {
+	{"port", STAGE_REQ_OFFSET, 4, port_init, port_start, port_step},
+	{"cuckoo", STAGE_REQ_OFFSET, 4, cuckoo_init, cuckoo_start, cuckoo_step},
+	{"lpm", STAGE_LPM_KEY_OFFSET, 4, lpm_init, lpm_start, lpm_step},
+	{"lpm6", STAGE_PAYLOAD_OFFSET, STAGE_LPM6_ADDR_SIZE, lpm6_init,
+		lpm6_start, lpm6_step},
+	{"mica", STAGE_PAYLOAD_OFFSET, 8, mica_init, mica_start, mica_step},
+	{"ndn", STAGE_PAYLOAD_OFFSET, STAGE_NDN_MAX_NAME_LEN, ndn_init,
+		ndn_start, ndn_step},
+	{"aho", STAGE_PAYLOAD_OFFSET, STAGE_AHO_PAYLOAD_LEN, aho_init,
+		aho_start, aho_step},
+};
+
+const struct lookup_stage *stage_find(const char *name)
+{
+	unsigned i;
+	for(i = 0; i < sizeof(stages) / sizeof(stages[0]); i ++) {
+		if(strcmp(stages[i].name, name) == 0) {
+			return &stages[i];
+		}
+	}
+
+	return NULL;
+}
+
+void stage_input_init(const struct lookup_stage *stage, struct stage_input *in,
+	struct rte_mbuf **pkts, int nb_pkts)
+{
+	int i;
+
+	in->nb_keys = nb_pkts;
+	in->key_offset = stage->key_offset;
+	in->key_len = stage->key_len;
+
+	for(i = 0; i < nb_pkts; i ++) {
+		in->base[i] = rte_pktmbuf_mtod(pkts[i], char *);
+	}
+}
+
+void stage_process_batch(const struct lookup_stage *stage, void *table,
+	const struct stage_input *in, int *dst_ports, struct stage_stats *stats)
+{
+	int batch_index = 0;
+
+	foreach(batch_index, in->nb_keys) {
+		struct stage_ctx ctx;
+
+		const void *addr = stage->start(table, &ctx,
+			stage_input_key(in, batch_index));
+
+		while(addr != NULL) {
+			FPP_EXPENSIVE(addr);
+			stats->nb_steps ++;
+			addr = stage->step(table, &ctx);
+		}
+
+		dst_ports[batch_index] = ctx.dst_port;
+		stats->nb_lookups ++;
+		stats->nb_hits += ctx.hit;
+	}
+}
+
+void stage_print_stats(const struct lookup_stage *stage,
+	struct stage_stats *stats, int lcore_id)
+{
+	LL nb_lookups = stats->nb_lookups == 0 ? 1 : stats->nb_lookups;
+
+	printf("\tLcore %d, stage %s: hit rate = %.2f, accesses/lookup = %.2f, "
+		"cycles/packet = %.1f\n",
+		lcore_id, stage->name, (double) stats->nb_hits / nb_lookups,
+		(double) stats->nb_steps / nb_lookups,
+		(double) stats->nb_cycles / nb_lookups);
+
+	memset(stats, 0, sizeof(struct stage_stats));
+}
+
+void stage_stats_add(struct stage_stats *tot, const struct stage_stats *stats)
+{
+	tot->nb_lookups += stats->nb_lookups;
+	tot->nb_hits += stats->nb_hits;
+	tot->nb_steps += stats->nb_steps;
+	tot->nb_cycles += stats->nb_cycles;
+}
@@ -0,0 +1,154 @@
+/**
+ * Lookup stages for the server. A stage maps each received packet to an
+ * output port using a memory-bound data structure, so that the server's
+ * throughput includes real lookup work and not just I/O.
+ *
+ * A lookup is split into steps at its expensive memory accesses. start()
+ * and step() return the address that the next step reads, or NULL when
+ * ctx->dst_port is ready. The server can then prefetch the address and
+ * switch to another packet (G-Opt), or simply call step() again.
+ *
+ * Stages read their keys in place from the packets of a burst through a
+ * struct stage_input: nothing is copied out of the mbufs.
+ */
+#include <rte_lpm.h>
+#include <rte_hash_crc.h>
+
+/**< Byte offset of the client's request in a packet (see README) */
+#define STAGE_REQ_OFFSET (36 + 20)
+
+/**< Engine input after the request, e.g., an IPv6 address (see gen.h) */
+#define STAGE_PAYLOAD_OFFSET (STAGE_REQ_OFFSET + 4)
+
+/**< The stage used when L2FWD_STAGE is not set */
+#define STAGE_DEFAULT "port"
+
+/**< Cuckoo stage: 512 MB of buckets, and keys 0 to CUCKOO_NUM_KEYS - 1 */
+#define STAGE_CUCKOO_NUM_BKT M_8
+#define STAGE_CUCKOO_NUM_BKT_ M_8_
+#define STAGE_CUCKOO_NUM_KEYS M_16
+#define STAGE_CUCKOO_NUM_KEYS_ M_16_
+
+/**< LPM stage: random prefixes on the IPv4 destination address */
+#define STAGE_LPM_NUM_PREFIXES 200000
+#define STAGE_LPM_KEY_OFFSET (sizeof(struct ether_hdr) + 16)	/**< dst_addr */
+
+/**< LPM6 stage: the tables of antlr/actual/ipv6's rte_lpm6 (a copy of
+  *  DPDK's), with one 48 to 64 bit prefix per flow of the generator's ipv6
+  *  profile. A prefix takes at most 5 tbl8s. */
+#define STAGE_LPM6_ADDR_SIZE 16
+#define STAGE_LPM6_NUM_PREFIXES 50000
+#define STAGE_LPM6_NUM_TBL8S (5 * STAGE_LPM6_NUM_PREFIXES)
+
+/**< NDN stage: antlr/actual/ndn's hash table (1 GB) with every prefix of
+  *  the names in STAGE_NDN_FIB_FILE (lzma -d data_dump/ndn/fib_1010.lzma
+  *  first). A name in a packet ends with a '\0'. */
+#define STAGE_NDN_FIB_FILE "../data_dump/ndn/fib_1010"
+#define STAGE_NDN_MAX_NAME_LEN 128	/**< The FIB's longest name is 97 bytes */
+#define STAGE_NDN_NUM_BKT M_8
+#define STAGE_NDN_NUM_BKT_ M_8_
+#define STAGE_NDN_SEED 3185
+
+/**< Aho-Corasick stage: antlr/actual/aho-corasick's DFA for the patterns of
+  *  Snort's largest DFA (1812 patterns), matched against a payload of
+  *  STAGE_AHO_PAYLOAD_LEN bytes */
+#define STAGE_AHO_PATTERN_FILE "../data_dump/snort/snort_dfa_patterns"
+#define STAGE_AHO_DFA_ID 51
+#define STAGE_AHO_MAX_STATES 65535	/**< Also the invalid state */
+#define STAGE_AHO_PAYLOAD_LEN 256
+
+/**< MICA stage: antlr/actual/mica's index and circular log (256 MB each),
+  *  with the 8-byte hashes of keys 1 to STAGE_MICA_NUM_KEYS - 1 */
+#define STAGE_MICA_INDEX_N M_4
+#define STAGE_MICA_INDEX_N_ M_4_
+#define STAGE_MICA_LOG_CAP M_16
+#define STAGE_MICA_LOG_CAP_ M_16_
+#define STAGE_MICA_NUM_KEYS STAGE_CUCKOO_NUM_KEYS
+
+/**< A strided view of a burst's keys: key i is the key_len bytes at
+  *  base[i] + key_offset, where base[i] is the packet's data. */
+struct stage_input {
+	char *base[BATCH_SIZE];
+	int nb_keys;
+	int key_offset;
+	int key_len;
+};
+
+static inline const void *stage_input_key(const struct stage_input *in, int i)
+{
+	return in->base[i] + in->key_offset;
+}
+
+/**< Per-packet lookup state */
+struct stage_ctx {
+	uint64_t key;
+	const uint8_t *in;	/**< The key in the packet, for keys that are read
+						  *  a byte at a time (names, payloads) */
+	int step;			/**< Stage-specific progress */
+	int pos;			/**< Stage-specific position in the key */
+	uint32_t index;		/**< Stage-specific table index */
+	int hit;			/**< 1 if the table had an entry for the key */
+	int dst_port;		/**< Result */
+};
+
+/**< Per-lcore stage statistics */
+struct stage_stats {
+	LL nb_lookups;
+	LL nb_hits;
+	LL nb_steps;		/**< Expensive memory accesses */
+	LL nb_cycles;		/**< In the server's batch function, which also rewrites
+						  *  and buffers packets */
+};
+
+struct lookup_stage {
+	const char *name;
+
+	/**< Where the key is in a packet */
+	int key_offset;
+	int key_len;
+
+	/**< Build the stage's table on socket_id. Returns the table. */
+	void *(*init)(int socket_id);
+
+	/**< key points into the packet (see stage_input_key()) */
+	const void *(*start)(void *table, struct stage_ctx *ctx, const void *key);
+	const void *(*step)(void *table, struct stage_ctx *ctx);
+};
+
+/**< The 8-byte key hash that the generator's key profile sends for a key,
+  *  and that the MICA stage stores */
+static inline uint64_t stage_key_hash(uint32_t key)
+{
+	return ((uint64_t) rte_hash_crc_4byte(key, 2) << 32) |
+		rte_hash_crc_4byte(key, 1);
+}
+
+/**< The IPv6 dst address of a flow in the generator's ipv6 profile */
+static inline void stage_flow_ipv6(uint32_t flow, uint8_t *addr)
+{
+	int i;
+	uint32_t *words = (uint32_t *) addr;
+
+	for(i = 0; i < 4; i ++) {
+		words[i] = rte_hash_crc_4byte(flow, i);
+	}
+}
+
+/**< Find a stage by name. Returns NULL if there is no such stage. */
+const struct lookup_stage *stage_find(const char *name);
+
+/**< Build the view of a burst for this stage. Packet data is not touched:
+  *  the G-Opt batch function prefetches each packet in its first stage. */
+void stage_input_init(const struct lookup_stage *stage, struct stage_input *in,
+	struct rte_mbuf **pkts, int nb_pkts);
+
+/**< Compute dst_ports for a burst, one packet at a time */
+void stage_process_batch(const struct lookup_stage *stage, void *table,
+	const struct stage_input *in, int *dst_ports, struct stage_stats *stats);
+
+/**< Print and reset stats */
+void stage_print_stats(const struct lookup_stage *stage,
+	struct stage_stats *stats, int lcore_id);
+
+/**< tot += stats */
+void stage_stats_add(struct stage_stats *tot, const struct stage_stats *stats);
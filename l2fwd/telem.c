@@ -0,0 +1,50 @@
+/* Per-lcore server telemetry: see telem.h */
+#include "main.h"
+
+struct telem *telem_init(int lcore_id, int queue_id, int port_mask)
+{
+	int key = TELEM_SHM_KEY + lcore_id;
+
+	/**< Small segments: no hugepages, unlike shm_alloc() */
+	int sid = shmget(key, sizeof(struct telem), IPC_CREAT | 0644);
+	CPE1(sid == -1, "Cannot create telemetry segment 0x%x\n", key);
+
+	struct telem *t = shmat(sid, 0, 0);
+	CPE1(t == (void *) -1, "Cannot attach telemetry segment 0x%x\n", key);
+
+	memset(t, 0, sizeof(struct telem));
+	t->magic = TELEM_MAGIC;
+	t->lcore_id = lcore_id;
+	t->socket_id = rte_lcore_to_socket_id(lcore_id);
+	t->queue_id = queue_id;
+	t->port_mask = port_mask & ((1 << TELEM_MAX_PORTS) - 1);
+	snprintf(t->stage_name, sizeof(t->stage_name), "%s", srv_stage->name);
+	t->tsc_hz = rte_get_tsc_hz();
+
+	printf("Lcore %d: telemetry in shm segment 0x%x\n", lcore_id, key);
+	return t;
+}
+
+void telem_publish(struct telem *t, struct lcore_port_info *lp_info,
+	struct stage_stats *stage_tot, struct stage_stats *stage_stats)
+{
+	int i;
+
+	telem_write_begin(t);
+
+	t->tsc = rte_rdtsc();
+
+	t->nb_lookups = stage_tot->nb_lookups + stage_stats->nb_lookups;
+	t->nb_hits = stage_tot->nb_hits + stage_stats->nb_hits;
+	t->nb_steps = stage_tot->nb_steps + stage_stats->nb_steps;
+	t->nb_batch_cycles = stage_tot->nb_cycles + stage_stats->nb_cycles;
+	t->nb_batch_pkts = t->nb_lookups;
+
+	for(i = 0; i < TELEM_MAX_PORTS; i ++) {
+		if(ISSET(t->port_mask, i)) {
+			t->port[i] = lp_info[i].telem;
+		}
+	}
+
+	telem_write_end(t);
+}
@@ -0,0 +1,102 @@
+/**
+ * Per-lcore server telemetry in SysV shared memory. Each server lcore owns
+ * the segment with key TELEM_SHM_KEY + lcore_id and republishes its
+ * counters there every TELEM_PUBLISH_US, so the forwarding path only bumps
+ * private counters. Counters are cumulative: readers compute rates from
+ * two snapshots. The segment is protected by a seqlock (seq is odd while
+ * the lcore writes it), so readers never block the lcore.
+ *
+ * This header is also used by telem-stat (telem/), which does not link
+ * with DPDK: keep it free of DPDK types.
+ */
+#include <stdint.h>
+
+#define TELEM_SHM_KEY 0x7e1e0000
+#define TELEM_MAGIC 0x7e1e0001		/**< Changes when the layout changes */
+#define TELEM_MAX_PORTS 8
+
+/**< How often a server lcore updates its segment */
+#define TELEM_PUBLISH_US 10000
+
+/**< Burst sizes are binned by power of 2: bucket 0 counts empty polls (RX)
+  *  and bucket b > 0 counts bursts of 2^(b - 1) to 2^b - 1 packets */
+#define TELEM_BURST_BUCKETS 8
+
+static inline int telem_burst_bucket(int nb_pkts)
+{
+	int b = nb_pkts == 0 ? 0 : 32 - __builtin_clz(nb_pkts);
+	return b < TELEM_BURST_BUCKETS ? b : TELEM_BURST_BUCKETS - 1;
+}
+
+struct telem_port {
+	uint64_t nb_rx;
+	uint64_t nb_tx;
+	uint64_t nb_drop;			/**< Buffered packets that the NIC did not take */
+	uint64_t rx_burst[TELEM_BURST_BUCKETS];	/**< rte_eth_rx_burst() sizes */
+	uint64_t tx_burst[TELEM_BURST_BUCKETS];	/**< rte_eth_tx_burst() sizes */
+};
+
+struct telem {
+	volatile uint64_t seq;
+
+	uint32_t magic;
+	int32_t lcore_id;
+	int32_t socket_id;
+	int32_t queue_id;
+	int32_t port_mask;			/**< Ports polled by this lcore */
+	char stage_name[20];
+
+	uint64_t tsc_hz;
+	uint64_t tsc;				/**< When this snapshot was published */
+
+	/**< Cycles spent in the batch function (lookup stage, header rewrite
+	  *  and TX buffering) and the packets that it processed */
+	uint64_t nb_batch_pkts;
+	uint64_t nb_batch_cycles;
+
+	/**< Lookup stage counters (see struct stage_stats) */
+	uint64_t nb_lookups;
+	uint64_t nb_hits;
+	uint64_t nb_steps;
+
+	struct telem_port port[TELEM_MAX_PORTS];
+};
+
+/**< Seqlock primitives, as in glock/striped_verlock/verlock.h. There is only
+  *  one writer per segment: the lcore that owns it. */
+static inline void telem_write_begin(struct telem *t)
+{
+	uint64_t cur = __atomic_load_n(&t->seq, __ATOMIC_RELAXED);
+	__atomic_store_n(&t->seq, cur + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void telem_write_end(struct telem *t)
+{
+	uint64_t cur = __atomic_load_n(&t->seq, __ATOMIC_RELAXED);
+	__atomic_store_n(&t->seq, cur + 1, __ATOMIC_RELEASE);
+}
+
+/**< Copy a consistent snapshot of a segment into dst */
+static inline void telem_read(struct telem *dst, struct telem *src)
+{
+	uint64_t start;
+	int i;
+	uint64_t *dst_w = (uint64_t *) dst, *src_w = (uint64_t *) src;
+
+	while(1) {
+		start = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE);
+		if(start & 1) {
+			continue;
+		}
+
+		for(i = 0; i < (int) (sizeof(struct telem) / sizeof(uint64_t)); i ++) {
+			dst_w[i] = __atomic_load_n(&src_w[i], __ATOMIC_RELAXED);
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if(__atomic_load_n(&src->seq, __ATOMIC_RELAXED) == start) {
+			return;
+		}
+	}
+}
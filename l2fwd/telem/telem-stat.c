@@ -0,0 +1,143 @@
+/**
+ * Print live per-lcore, per-port server stats from the telemetry segments
+ * (../telem.h) of a running l2fwd server. Needs no DPDK and does not slow
+ * down the server: the segments are only read.
+ *
+ * Usage: ./telem-stat [interval in seconds, default 1]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "../telem.h"
+
+/**< Lcore ids that are scanned for segments */
+#define STAT_MAX_LCORE 128
+
+struct telem *segs[STAT_MAX_LCORE];
+struct telem prev[STAT_MAX_LCORE], cur[STAT_MAX_LCORE];
+
+static int attach_all(void)
+{
+	int lcore_id, nb_segs = 0;
+
+	for(lcore_id = 0; lcore_id < STAT_MAX_LCORE; lcore_id ++) {
+		int sid = shmget(TELEM_SHM_KEY + lcore_id, sizeof(struct telem), 0);
+		if(sid == -1) {
+			continue;
+		}
+
+		struct telem *t = shmat(sid, 0, SHM_RDONLY);
+		if(t == (void *) -1) {
+			continue;
+		}
+
+		if(t->magic != TELEM_MAGIC) {
+			fprintf(stderr, "Lcore %d: segment has an unknown layout. "
+				"Rebuild telem-stat.\n", lcore_id);
+			shmdt(t);
+			continue;
+		}
+
+		segs[lcore_id] = t;
+		nb_segs ++;
+	}
+
+	return nb_segs;
+}
+
+/**< Number of bursts in a histogram, with or without bucket 0 */
+static uint64_t nb_bursts(uint64_t *cur_hist, uint64_t *prev_hist, int from)
+{
+	int b;
+	uint64_t n = 0;
+
+	for(b = from; b < TELEM_BURST_BUCKETS; b ++) {
+		n += cur_hist[b] - prev_hist[b];
+	}
+
+	return n;
+}
+
+static void print_lcore(struct telem *c, struct telem *p)
+{
+	int i;
+	if(p->tsc == 0 || c->tsc == p->tsc) {
+		printf("Lcore %2d: no update\n", c->lcore_id);
+		return;
+	}
+
+	double seconds = (double) (c->tsc - p->tsc) / c->tsc_hz;
+
+	uint64_t nb_lookups = c->nb_lookups - p->nb_lookups;
+	uint64_t nb_pkts = c->nb_batch_pkts - p->nb_batch_pkts;
+	uint64_t nb_cycles = c->nb_batch_cycles - p->nb_batch_cycles;
+
+	printf("Lcore %2d (socket %d, queue %d), stage %s: "
+		"cycles/pkt %.1f, hit rate %.2f, accesses/lookup %.2f\n",
+		c->lcore_id, c->socket_id, c->queue_id, c->stage_name,
+		nb_pkts == 0 ? 0 : (double) nb_cycles / nb_pkts,
+		nb_lookups == 0 ? 0 : (double) (c->nb_hits - p->nb_hits) / nb_lookups,
+		nb_lookups == 0 ? 0 : (double) (c->nb_steps - p->nb_steps) / nb_lookups);
+
+	for(i = 0; i < TELEM_MAX_PORTS; i ++) {
+		if(!(c->port_mask & (1 << i))) {
+			continue;
+		}
+
+		struct telem_port *cp = &c->port[i], *pp = &p->port[i];
+		uint64_t nb_rx = cp->nb_rx - pp->nb_rx;
+		uint64_t nb_tx = cp->nb_tx - pp->nb_tx;
+		uint64_t nb_drop = cp->nb_drop - pp->nb_drop;
+
+		uint64_t nb_polls = nb_bursts(cp->rx_burst, pp->rx_burst, 0);
+		uint64_t nb_rx_bursts = nb_bursts(cp->rx_burst, pp->rx_burst, 1);
+		uint64_t nb_tx_bursts = nb_bursts(cp->tx_burst, pp->tx_burst, 1);
+
+		printf("\tport %d: RX %.3f Mpps, TX %.3f Mpps, drop %.3f Mpps, "
+			"RX burst %.1f (%.0f%% empty polls), TX burst %.1f\n", i,
+			nb_rx / seconds / 1e6, nb_tx / seconds / 1e6, nb_drop / seconds / 1e6,
+			nb_rx_bursts == 0 ? 0 : (double) nb_rx / nb_rx_bursts,
+			nb_polls == 0 ? 0 : 100.0 * (nb_polls - nb_rx_bursts) / nb_polls,
+			nb_tx_bursts == 0 ? 0 : (double) (nb_tx + nb_drop) / nb_tx_bursts);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int lcore_id;
+	double interval = argc > 1 ? atof(argv[1]) : 1;
+
+	if(attach_all() == 0) {
+		fprintf(stderr, "No telemetry segments. Is the l2fwd server running?\n");
+		exit(-1);
+	}
+
+	for(lcore_id = 0; lcore_id < STAT_MAX_LCORE; lcore_id ++) {
+		if(segs[lcore_id] != NULL) {
+			telem_read(&prev[lcore_id], segs[lcore_id]);
+		}
+	}
+
+	while(1) {
+		usleep(interval * 1000000);
+
+		for(lcore_id = 0; lcore_id < STAT_MAX_LCORE; lcore_id ++) {
+			if(segs[lcore_id] == NULL) {
+				continue;
+			}
+
+			telem_read(&cur[lcore_id], segs[lcore_id]);
+			print_lcore(&cur[lcore_id], &prev[lcore_id]);
+			prev[lcore_id] = cur[lcore_id];
+		}
+
+		printf("\n");
+		fflush(stdout);
+	}
+
+	return 0;
+}
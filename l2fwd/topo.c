@@ -0,0 +1,158 @@
+/* NUMA-aware mapping of server lcores to ports and queues */
+#include "main.h"
+
+struct topo topo;
+
+static int topo_lcore_socket(int lcore_id)
+{
+	int socket_id = rte_lcore_to_socket_id(lcore_id);
+	assert(socket_id >= 0 && socket_id < RTE_MAX_NUMA_NODES);
+	return socket_id;
+}
+
+/**< Number of generator lcores on port_id */
+static int topo_port_nb_gens(int port_id)
+{
+	int lcore_id, nb_gens = 0;
+	if(l2fwd_conf == NULL) {
+		return 0;
+	}
+
+	for(lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id ++) {
+		if(l2fwd_conf->role[lcore_id] == CONF_ROLE_GEN &&
+			l2fwd_conf->gen_port[lcore_id] == port_id) {
+			nb_gens ++;
+		}
+	}
+
+	return nb_gens;
+}
+
+void topo_init(int srv_port_mask, int gen_port_mask, int nb_ports)
+{
+	int lcore_id, port_id, socket_id;
+	int used_mask = srv_port_mask | gen_port_mask;
+
+	memset(&topo, 0, sizeof(struct topo));
+
+	for(lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id ++) {
+		if(!rte_lcore_is_enabled(lcore_id)) {
+			continue;
+		}
+
+		int role = l2fwd_conf == NULL ? CONF_ROLE_SRV : l2fwd_conf->role[lcore_id];
+		socket_id = topo_lcore_socket(lcore_id);
+
+		/**< In pipeline mode, rx_lcores own the queues */
+		if(role == CONF_ROLE_SRV || role == CONF_ROLE_RX) {
+			topo.is_srv_lcore[lcore_id] = 1;
+			topo.socket_nb_srv_lcores[socket_id] ++;
+		}
+
+		if(role == CONF_ROLE_SRV || role == CONF_ROLE_LOOKUP) {
+			topo.socket_needs_table[socket_id] = 1;
+		}
+	}
+
+	for(port_id = 0; port_id < nb_ports; port_id ++) {
+		if(!ISSET(used_mask, port_id)) {
+			continue;
+		}
+
+		socket_id = rte_eth_dev_socket_id(port_id);
+		socket_id = socket_id < 0 ? 0 : socket_id;
+		topo.port_socket[port_id] = socket_id;
+
+		/**< Each generator gets its own queue, even if the socket has fewer
+		  *  servers (conf_load() checks this for ring_pair ports) */
+		int nb_queues = topo.socket_nb_srv_lcores[socket_id];
+		if(ISSET(gen_port_mask, port_id)) {
+			nb_queues = MAX(nb_queues, topo_port_nb_gens(port_id));
+		}
+
+		topo.port_nb_queues[port_id] = nb_queues;
+
+		if(ISSET(srv_port_mask, port_id) && nb_queues > 0) {
+			topo.socket_port_mask[socket_id] |= (1 << port_id);
+		}
+	}
+
+	for(socket_id = 0; socket_id < RTE_MAX_NUMA_NODES; socket_id ++) {
+		if(topo.socket_nb_srv_lcores[socket_id] != 0) {
+			red_printf("Socket %d: %d server lcores, server port mask 0x%x\n",
+				socket_id, topo.socket_nb_srv_lcores[socket_id],
+				topo.socket_port_mask[socket_id]);
+		}
+	}
+}
+
+/**< Rank of lcore_id among the server lcores of its socket, or among the
+  *  generator lcores of its port */
+static int topo_lcore_rank(int lcore_id)
+{
+	int lid, rank = -1;
+	int is_gen = !topo.is_srv_lcore[lcore_id];
+
+	for(lid = 0; lid <= lcore_id; lid ++) {
+		if(is_gen) {
+			if(l2fwd_conf->role[lid] == CONF_ROLE_GEN &&
+				l2fwd_conf->gen_port[lid] == l2fwd_conf->gen_port[lcore_id]) {
+				rank ++;
+			}
+		} else if(topo.is_srv_lcore[lid] &&
+			topo_lcore_socket(lid) == topo_lcore_socket(lcore_id)) {
+			rank ++;
+		}
+	}
+
+	return rank;
+}
+
+int topo_lcore_queue(int lcore_id)
+{
+	if(topo.is_srv_lcore[lcore_id]) {
+		return topo_lcore_rank(lcore_id);
+	}
+
+	/**< The n-th generator of a port uses queue n */
+	assert(l2fwd_conf != NULL && l2fwd_conf->role[lcore_id] == CONF_ROLE_GEN);
+	int port_id = l2fwd_conf->gen_port[lcore_id];
+	int queue_id = topo_lcore_rank(lcore_id);
+	assert(queue_id < topo.port_nb_queues[port_id]);
+	return queue_id;
+}
+
+int topo_queue_to_lcore(int port_id, int queue_id)
+{
+	int lcore_id;
+	int socket_id = topo.port_socket[port_id];
+
+	if(l2fwd_conf != NULL && ISSET(l2fwd_conf->gen_port_mask, port_id)) {
+		for(lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id ++) {
+			if(l2fwd_conf->role[lcore_id] == CONF_ROLE_GEN &&
+				l2fwd_conf->gen_port[lcore_id] == port_id &&
+				topo_lcore_queue(lcore_id) == queue_id) {
+				return lcore_id;
+			}
+		}
+	}
+
+	/**< Server ports, and generator queues without a generator */
+	for(lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id ++) {
+		if(topo.is_srv_lcore[lcore_id] &&
+			topo_lcore_socket(lcore_id) == socket_id &&
+			topo_lcore_queue(lcore_id) == queue_id) {
+			return lcore_id;
+		}
+	}
+
+	/**< A generator port on a socket without servers */
+	for(lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id ++) {
+		if(topo.is_srv_lcore[lcore_id]) {
+			return lcore_id;
+		}
+	}
+
+	assert(0);
+	return -1;
+}
@@ -0,0 +1,32 @@
+/**
+ * Server topology: the ports, queues and lookup table of each server lcore.
+ * A server lcore only polls and transmits on the server ports of its own
+ * socket, and the n-th server lcore of a socket uses queue n on each of
+ * them, so neither packets nor tables cross the QPI. Sockets come from EAL
+ * (rte_lcore_to_socket_id() and rte_eth_dev_socket_id()). Ports without a
+ * socket, such as virtual devices or NICs behind an I/O hub, are put on
+ * socket 0.
+ */
+struct topo {
+	int port_socket[RTE_MAX_ETHPORTS];
+	int port_nb_queues[RTE_MAX_ETHPORTS];	/**< 0 for unused ports */
+
+	int socket_port_mask[RTE_MAX_NUMA_NODES];	/**< Server ports */
+	int socket_nb_srv_lcores[RTE_MAX_NUMA_NODES];
+	int socket_needs_table[RTE_MAX_NUMA_NODES];	/**< Has lcores that do lookups */
+
+	int is_srv_lcore[RTE_MAX_LCORE];
+};
+
+extern struct topo topo;
+
+/**< Map the server (and generator) ports and lcores. Call after all ports
+  *  exist. Server lcores are the enabled lcores, or the config's srv_lcores
+  *  (or rx_lcores in pipeline mode) with L2FWD_CONF. */
+void topo_init(int srv_port_mask, int gen_port_mask, int nb_ports);
+
+/**< The queue that a server or generator lcore uses on its ports */
+int topo_lcore_queue(int lcore_id);
+
+/**< The lcore whose mempool backs queue_id of port_id */
+int topo_queue_to_lcore(int port_id, int queue_id);